@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <atomic>
 
@@ -7,12 +9,19 @@ class ActiveBarrier {
 private:
     atomic<int> count;
     int reset_value;
+
+    // Used only by wait(), where the last thread to arrive resets the barrier
+    atomic<unsigned> generation; // Number of completed barriers
+    atomic<unsigned long> flags_or;
+    unsigned long result;
   
 public:
     // Initialize the barrier
     ActiveBarrier(int v) {
         reset_value = v;
         count = v;
+        generation = 0;
+        flags_or = 0;
     }
 
     // Reset the barrier's value
@@ -36,4 +45,30 @@ public:
     void wait_all_nomod() {
         while(count > 0) ;
     }
+
+    /*
+     * Barrier wait without a master thread: the last thread to arrive runs
+     * 'complete(all)', resets the barrier and releases the others
+     * Returns the OR of the flags of all the threads
+     */
+    template<typename F>
+    unsigned long wait(int, unsigned long flags, F complete) {
+        unsigned g = generation;
+        if(flags) flags_or |= flags;
+
+        if(--count > 0) {
+            while(generation == g) ;
+            return result;
+        }
+
+        result = flags_or.exchange(0);
+        count = reset_value;
+        complete(result);
+        generation++;
+        return result;
+    }
+
+    unsigned long wait(int t, unsigned long flags) {
+        return wait(t, flags, [] (unsigned long) {});
+    }
 };
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * Tracks which chunks of the array can still change
+ * A couple that did not swap keeps its order until one of its elements is
+ * moved by the other phase, so a chunk needs to be scanned only if it, or
+ * one of its neighbours, had some swaps in the previous phase.
+ * Chunk 'c' covers the couples starting in [c*chunksize, (c+1)*chunksize)
+ * in the even phase, and the ones shifted by one position in the odd phase,
+ * the same division used by TaskManager.
+ * Each chunk must be updated by a single thread in each phase; the state of
+ * the previous phase is only read, so no synchronization is needed besides
+ * the barrier between phases.
+ */
+class ActiveRegion {
+private:
+    int size, chunksize, nchunks;
+    vector<unsigned char> changed[2]; // Chunks with swaps in the last even/odd phase
+
+public:
+    // Initialize the tracking for 's' elements, chunks of 'c' elements (0 => disabled)
+    ActiveRegion(int s, int c) : size(s) {
+        chunksize = max(2, c + c%2); // Chunks must start at the parity of the phase
+        nchunks = (c > 0) ? (size + chunksize - 1)/chunksize : 0;
+        changed[0].assign(nchunks, 1);
+        changed[1].assign(nchunks, 1);
+    }
+
+    int chunks() {
+        return nchunks;
+    }
+
+    int chunk_size() {
+        return chunksize;
+    }
+
+    // Extremes of chunk 'c' in the phase with parity 'par' (0 even, 1 odd)
+    void bounds(int c, int par, int *s, int *e) {
+        *s = min(size, c*chunksize + par);
+        *e = min(size, (c+1)*chunksize + par);
+    }
+
+    // True if chunk 'c' has to be scanned in phase 'par' of iteration 'iter'
+    // Every chunk is dirty in the first iteration, its couples were never compared
+    bool dirty(int c, int par, unsigned long iter) {
+        if(iter <= 1) return true;
+
+        vector<unsigned char> &prev = changed[1-par];
+        return prev[c] || (c > 0 && prev[c-1]) || (c < nchunks-1 && prev[c+1]);
+    }
+
+    // Record the number of swaps of chunk 'c' in phase 'par'
+    void update(int c, int par, int nswaps) {
+        changed[par][c] = (nswaps > 0);
+    }
+
+    /*
+     * Scans the dirty chunks in [first, last) with 'f(s, e)', which returns
+     * the number of swaps in the interval, and updates their state
+     * Returns the total number of swaps
+     */
+    template<typename F>
+    int scan(int first, int last, int par, unsigned long iter, F f) {
+        int nswaps = 0;
+        for(int c=first; c<last; c++) {
+            int n = 0;
+            if(dirty(c, par, iter)) {
+                int s, e;
+                bounds(c, par, &s, &e);
+                n = f(s, e);
+            }
+            update(c, par, n);
+            nswaps += n;
+        }
+
+        return nswaps;
+    }
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+/*
+ * Thread pinning and NUMA placement
+ * The CPUs of each node are read from sysfs; on machines without NUMA
+ * information all the CPUs belong to node 0.
+ */
+
+/*
+ * Parses a list of CPUs such as "0-3,8,10-11"
+ */
+vector<int> parse_cpulist(const string &list) {
+    vector<int> cpus;
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == string::npos) end = list.size();
+
+        string item = list.substr(pos, end-pos);
+        size_t dash = item.find('-');
+        if(!item.empty()) {
+            int first = stoi(item.substr(0, dash));
+            int last = (dash == string::npos) ? first : stoi(item.substr(dash+1));
+            for(int c=first; c<=last; c++) cpus.push_back(c);
+        }
+        pos = end+1;
+    }
+    return cpus;
+}
+
+/*
+ * CPUs of each NUMA node that the process is allowed to use
+ * Nodes without usable CPUs are left out
+ */
+vector<vector<int>> numa_nodes() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    vector<vector<int>> nodes;
+    for(int n=0; n<1024; n++) {
+        ifstream f("/sys/devices/system/node/node" + to_string(n) + "/cpulist");
+        if(!f) continue;
+
+        string list;
+        getline(f, list);
+        vector<int> cpus;
+        for(int c : parse_cpulist(list))
+            if(c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        if(!cpus.empty()) nodes.push_back(cpus);
+    }
+
+    if(nodes.empty()) {
+        vector<int> cpus;
+        for(int c=0; c<CPU_SETSIZE; c++)
+            if(CPU_ISSET(c, &allowed)) cpus.push_back(c);
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+/*
+ * Computes the CPU of each of the 'nw' workers with the given policy
+ *      none    : no pinning ('cpus' is left empty)
+ *      compact : fill the CPUs of a node before moving to the next one
+ *      scatter : round robin on the nodes
+ *      a list of CPUs, e.g. "0,2,4-7", used in order (cyclically)
+ * Returns false if the policy is unknown
+ */
+bool pin_plan(const char *policy, int nw, vector<int> &cpus) {
+    cpus.clear();
+    if(strcmp(policy, "none") == 0) return true;
+
+    vector<vector<int>> nodes = numa_nodes();
+    vector<int> order;
+
+    if(strcmp(policy, "compact") == 0) {
+        for(auto &n : nodes)
+            order.insert(order.end(), n.begin(), n.end());
+    } else if(strcmp(policy, "scatter") == 0) {
+        for(size_t k=0; order.size() < (size_t)nw*nodes.size(); k++)
+            for(auto &n : nodes)
+                order.push_back(n[k % n.size()]);
+    } else if(isdigit(policy[0])) {
+        order = parse_cpulist(policy);
+    }
+
+    if(order.empty()) {
+        cout << "Unknown pinning policy " << policy << endl;
+        return false;
+    }
+
+    for(int t=0; t<nw; t++)
+        cpus.push_back(order[t % order.size()]);
+    return true;
+}
+
+/*
+ * Index of the node of 'cpu' in numa_nodes() (0 if not found)
+ */
+int cpu_node(const vector<vector<int>> &nodes, int cpu) {
+    for(size_t n=0; n<nodes.size(); n++)
+        if(find(nodes[n].begin(), nodes[n].end(), cpu) != nodes[n].end()) return n;
+    return 0;
+}
+
+/*
+ * Pins the calling thread, worker 't', to its CPU in 'cpus' (no-op if empty)
+ */
+void pin_worker(const vector<int> &cpus, int t) {
+    if(cpus.empty()) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[t], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+ * Affinity of the calling thread, saved by main before it runs as a pinned
+ * worker and restored with set_affinity afterwards
+ */
+cpu_set_t get_affinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    return set;
+}
+
+void set_affinity(const cpu_set_t &set) {
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+ * First touch: each worker, pinned to its CPU, writes the elements of its
+ * partition as computed by 'value(i)' (e.g. an InputGenerator), so that
+ * the pages of 'A' are allocated on its node, without a copy of the whole
+ * problem
+ * 'A' must not have been initialized (see default_init_allocator)
+ *      part(t, &lo, &hi) : partition of worker t
+ */
+template<typename T, typename Alloc, typename Part, typename F>
+void first_touch_fill(vector<T, Alloc> &A, F value, int nw, const vector<int> &cpus, Part part) {
+    vector<thread> threads;
+    for(int t=0; t<nw; t++)
+        threads.emplace_back([&, t] {
+            pin_worker(cpus, t);
+            int lo, hi;
+            part(t, &lo, &hi);
+            for(int i=lo; i<hi; i++) A[i] = T(value(i));
+        });
+
+    for(auto &th : threads) th.join();
+}
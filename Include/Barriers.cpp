@@ -0,0 +1,48 @@
+#pragma once
+
+#include <iostream>
+#include <cstring>
+
+#include "ActiveBarrier.cpp"
+#include "HybridBarrier.cpp"
+#include "TreeBarrier.cpp"
+
+using namespace std;
+
+template<typename T> struct barrier_tag { using type = T; };
+
+/*
+ * True for the barriers that can be driven by a master thread (reset,
+ * wait_reset, wait_all_nomod). All of them support wait(t, flags, complete),
+ * where the workers synchronize among themselves and get the termination
+ * from the barrier; TreeBarrier supports only that
+ */
+template<typename B>
+constexpr bool master_barrier = !is_same_v<B, TreeBarrier>;
+
+/*
+ * Builds a barrier for 'v' threads, 'spin' is used only by the barriers
+ * that can sleep
+ */
+template<typename B>
+B make_barrier(int v, int spin) {
+    if constexpr (is_same_v<B, HybridBarrier>) return B(v, spin);
+    else return B(v);
+}
+
+/*
+ * Calls 'f' with the barrier_tag of the barrier named 'name'
+ *		active : ActiveBarrier, pure busy waiting
+ *		hybrid : HybridBarrier, spin then sleep
+ *		tree   : TreeBarrier, combining tree with OR reduction
+ * Returns -1 if the name is unknown
+ */
+template<typename F>
+int dispatch_barrier(const char *name, F f) {
+    if(strcmp(name, "active") == 0) return f(barrier_tag<ActiveBarrier>());
+    if(strcmp(name, "hybrid") == 0) return f(barrier_tag<HybridBarrier>());
+    if(strcmp(name, "tree") == 0) return f(barrier_tag<TreeBarrier>());
+
+    cout << "Unknown barrier " << name << endl;
+    return -1;
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "business_logic.cpp"
+#include "utils.cpp"
+#include "ActiveBarrier.cpp"
+#include "Timer.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Block version of the Odd-even Sort (odd-even-par-block.cpp), callable
+ * in-process: each worker sorts its block locally, then in each round a
+ * couple of adjacent workers merges the two blocks.
+ * Prints the time and the iterations (rounds) when 'report' is set.
+ * Returns the number of iterations
+ */
+template<typename T, typename Compare, typename Alloc>
+long odd_even_par_block(vector<T, Alloc> &A, int nw, bool report = true) {
+    int N = A.size();
+
+    // An empty block would separate its neighbours forever
+    nw = max(1, min(nw, N/2));
+
+    // Statistics
+    unsigned long iter = 0;
+#if STATS
+    mutex print_m; // For mutual exclusive prints
+#endif
+
+    auto start = high_resolution_clock::now();
+
+    Compare comp; // Ordering of the elements
+    sort_network_fun<T> network = select_sort_network<T, Compare>(); // Local sort of the small blocks
+
+    // Variable for the stopping condition
+    atomic<int> swapped = 0;
+
+    // Variables and structures for synchronization
+    atomic<bool> terminate = false;
+    ActiveBarrier sort_barrier(nw);                  // End of the local sort
+    ActiveBarrier even_merge(nw), even_write(nw);    // Even round
+    ActiveBarrier odd_merge(nw), end_barrier(nw);    // Odd round
+
+    // Blocks, same partition of the even phase of the element-wise version
+    // (the last worker takes the odd element)
+    int E = N/2;
+    auto block_start = [&] (int t) {
+        return (t == 0) ? 0 : 2*( t*(E/nw) + min(E%nw, t) );
+    };
+    auto block_end = [&] (int t) {
+        return (t == nw-1) ? N : block_start(t) + 2*( (E/nw) + (t < E%nw) );
+    };
+
+    auto worker_fun = [&] (int t)
+    {
+#if STATS
+        unsigned long sort_time = 0;                        // Local sort
+        unsigned long merge_time = 0, write_time = 0;       // Merge-split
+        unsigned long merges = 0;
+        unsigned long barrier_t = 0, update_t = 0;          // Overhead statistics
+
+        unsigned long temp;
+#endif
+
+        int lo = block_start(t), hi = block_end(t);
+        vector<T> B(hi-lo); // Private result of the merge-split
+
+        /*
+         * Merge-split with the neighbour 'n', writing to B the part of the
+         * merged blocks belonging to this worker
+         * Returns false if the blocks are already in order
+         */
+        auto merge_split = [&] (int n) {
+            if(n < 0 || n >= nw) return false;
+            return merge_split_blocks(A.data(), lo, hi, block_start(n), block_end(n), B.data(), comp);
+        };
+
+        // Local sort
+#if STATS
+        {   Timer t_sort(&temp);
+#endif
+            if(hi-lo <= SMALL_SORT && network) network(A.data()+lo, hi-lo);
+            else sort(A.begin()+lo, A.begin()+hi, comp);
+#if STATS
+        }   sort_time = temp;
+#endif
+        sort_barrier.wait_all();
+
+        // Even round: 0-1, 2-3, ...; odd round: 1-2, 3-4, ...
+        int even_n = (t%2 == 0) ? t+1 : t-1;
+        int odd_n  = (t%2 == 0) ? t-1 : t+1;
+
+        bool changed;
+        int swapped_prv;
+        while(!terminate) {
+            // Even round
+#if STATS
+            {   Timer t_merge(&temp);
+#endif
+                changed = merge_split(even_n);
+                swapped_prv = changed;
+#if STATS
+            }   merge_time += temp;
+                merges += changed;
+#endif
+
+            // Barrier, the neighbour has read the block
+#if STATS
+            {   Timer t_b(&temp);
+#endif
+                even_merge.wait_all();
+#if STATS
+            }   barrier_t += temp;
+#endif
+
+#if STATS
+            {   Timer t_write(&temp);
+#endif
+                if(changed) copy(B.begin(), B.end(), A.begin()+lo);
+#if STATS
+            }   write_time += temp;
+#endif
+
+            // Barrier, the blocks are updated
+#if STATS
+            {   Timer t_b(&temp);
+#endif
+                even_write.wait_all();
+#if STATS
+            }   barrier_t += temp;
+#endif
+
+            // Odd round
+#if STATS
+            {   Timer t_merge(&temp);
+#endif
+                changed = merge_split(odd_n);
+                swapped_prv |= changed;
+#if STATS
+            }   merge_time += temp;
+                merges += changed;
+#endif
+
+#if STATS
+            {   Timer t_b(&temp);
+#endif
+                odd_merge.wait_all();
+#if STATS
+            }   barrier_t += temp;
+#endif
+
+#if STATS
+            {   Timer t_write(&temp);
+#endif
+                if(changed) copy(B.begin(), B.end(), A.begin()+lo);
+#if STATS
+            }   write_time += temp;
+#endif
+
+            // Atomicly update the shared variable
+#if STATS
+            {   Timer t_update(&temp);
+#endif
+                swapped |= swapped_prv;
+#if STATS
+            }   update_t += temp;
+#endif
+
+            // Barrier, wait for the master thread (main) to reset the barrier
+#if STATS
+            {   Timer t_b(&temp);
+#endif
+                end_barrier.wait_reset();
+#if STATS
+            }   barrier_t += temp;
+#endif
+        } // End of loop
+
+
+#if STATS
+        {
+            unique_lock<mutex> print_lock(print_m);
+            cout << "Worker " << t << ":" << endl
+                 << "\tLocal sort     " << ((float)sort_time)/1000 << " usecs" << endl
+                 << "\tAvg merge      " << ((float)merge_time)/iter/1000 << " usecs"
+                 << " (" << merges << " merge-splits)" << endl
+                 << "\tAvg write      " << ((float)write_time)/iter/1000 << " usecs" << endl
+                 << "\tAvg update     " << ((float)update_t)/iter/1000 << " usecs" << endl
+                 << "\tAvg barriers   " << ((float)barrier_t)/iter/1000 << " usecs" << endl << endl;
+        }
+#endif
+
+        return;
+    };
+
+    // Start the workers
+    vector<thread> workers;
+    for(int i=0; i<nw; i++)
+        workers.emplace_back(worker_fun, i);
+
+    while(true) {
+        iter++;
+
+        // Wait for the end of the iteration
+        end_barrier.wait_all_nomod();
+#if PRINT
+        cout << "ITER  ";
+        print_vector(A);
+#endif
+
+        // Check for termination
+        if(!swapped) break;
+        even_merge.reset();
+        even_write.reset();
+        odd_merge.reset();
+        swapped = 0;
+        end_barrier.reset();
+    }
+
+    terminate = true; // Send termination signal
+    end_barrier.reset();
+    for(auto &w : workers)
+        w.join();
+
+    auto stop = high_resolution_clock::now();
+    auto total_time = duration_cast<microseconds>(stop - start).count();
+
+
+    if(report) {
+        cout << "Total time with " << nw << " workers: " << ((float)total_time)/1000.0 << " msecs" << endl;
+        cout << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
+    }
+
+    return iter;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+#include <sys/mman.h>
+
+#include "utils.cpp"
+#include "Transport.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Distributed version of the block Odd-even Sort (odd-even-dist.cpp),
+ * callable in-process: the ranks are forked by the caller, see
+ * spawn_ranks. parse reads (and removes) its options from argc/argv.
+ */
+struct dist_options {
+    const char *kind = "shm";   // -x : transport, shm or unix
+    int capacity = 1 << 20;     // -c : bytes of each shared memory channel
+    bool report = true; // Prints the timing lines and the statistics of the ranks
+
+    void parse(int &argc, char const *argv[]) {
+        kind = get_option(argc, argv, "-x", kind);
+        capacity = get_option(argc, argv, "-c", capacity);
+    }
+};
+
+/*
+ * Sorts the N elements value(0), ..., value(N-1) with 'np' ranks, each one
+ * taking its own partition from 'value' (e.g. an InputGenerator). When
+ * 'out' is not null, a shared mapping of N elements, each rank writes its
+ * sorted partition there.
+ * Returns the number of iterations, -1 on error (not sorted, a rank failed
+ * or the options are not valid)
+ */
+template<typename T, typename Compare, typename F>
+long odd_even_dist_ranks(long N, F value, T *out, int np, const dist_options &opt) {
+    static_assert(is_trivially_copyable_v<T>, "the elements are sent as bytes");
+    if(N < 2) return 0;
+    np = max(1L, min((long)np, N)); // An empty partition would separate its neighbours
+
+    if(opt.capacity < (int)sizeof(T)) {
+        cout << "The capacity of a channel must be at least one element (" << sizeof(T) << " bytes)" << endl;
+        return -1;
+    }
+
+    // Iterations, written by rank 0
+    long *result = (long *)mmap(nullptr, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(result == MAP_FAILED) {
+        cout << "Cannot map the result" << endl;
+        return -1;
+    }
+    *result = -1;
+
+    auto rank_fun = [&] (Transport &tr) {
+        Compare comp;
+        int r = tr.rank();
+        long lo = N*r/np, hi = N*(r+1)/np;
+
+        vector<T> A(hi-lo), B, M(hi-lo); // Partition, received block, merge result
+        for(long i=lo; i<hi; i++) A[i-lo] = T(value(i));
+
+        unsigned long iter = 0, merges = 0;
+        unsigned long sort_time = 0;
+
+        /*
+         * Merge-split with the neighbour 'm'; the left rank sends first,
+         * so that a rank never waits for a neighbour that is sending to it
+         * Returns true if the partition changed
+         */
+        auto merge_split = [&] (int m) {
+            if(m < 0 || m >= np) return false;
+
+            T ext;
+            size_t ns, nr;
+            if(m > r) {
+                // Left: keeps the smallest elements
+                tr.send(m, &A.back(), sizeof(T));
+                tr.recv(m, &ext, sizeof(T));
+
+                auto s = upper_bound(A.begin(), A.end(), ext, comp);
+                ns = A.end() - s;
+                tr.send(m, &ns, sizeof(ns));
+                if(ns) tr.send(m, &*s, ns*sizeof(T));
+                tr.recv(m, &nr, sizeof(nr));
+                B.resize(nr);
+                if(nr) tr.recv(m, B.data(), nr*sizeof(T));
+                if(nr == 0) return false;
+
+                size_t i = 0, j = 0;
+                for(size_t k=0; k<A.size(); k++)
+                    M[k] = (j == nr || !comp(B[j], A[i])) ? A[i++] : B[j++];
+            } else {
+                // Right: keeps the largest elements
+                tr.recv(m, &ext, sizeof(T));
+                tr.send(m, &A.front(), sizeof(T));
+
+                tr.recv(m, &nr, sizeof(nr));
+                B.resize(nr);
+                if(nr) tr.recv(m, B.data(), nr*sizeof(T));
+                auto s = lower_bound(A.begin(), A.end(), ext, comp);
+                ns = s - A.begin();
+                tr.send(m, &ns, sizeof(ns));
+                if(ns) tr.send(m, A.data(), ns*sizeof(T));
+                if(nr == 0) return false;
+
+                long i = A.size()-1, j = nr-1;
+                for(long k=A.size()-1; k>=0; k--)
+                    M[k] = (j < 0 || !comp(A[i], B[j])) ? A[i--] : B[j--];
+            }
+
+            swap(A, M);
+            merges++;
+            return true;
+        };
+
+        // Start together, the wait for the other ranks to start is not counted
+        tr.allreduce_or(0);
+        tr.reset_counters();
+        auto start = high_resolution_clock::now();
+
+        // Local sort
+        sort(A.begin(), A.end(), comp);
+        sort_time = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+
+        // Even round: 0-1, 2-3, ...; odd round: 1-2, 3-4, ...
+        int even_n = (r%2 == 0) ? r+1 : r-1;
+        int odd_n  = (r%2 == 0) ? r-1 : r+1;
+
+        while(true) {
+            iter++;
+            bool changed = merge_split(even_n);
+            changed |= merge_split(odd_n);
+            if(!tr.allreduce_or(changed)) break;
+        }
+
+        auto stop = high_resolution_clock::now();
+        auto total_time = duration_cast<microseconds>(stop - start).count();
+
+        // Statistics of the sort, before the check
+        ostringstream stats;
+        stats << "Rank " << r << ": " << A.size() << " elements, " << merges << " merge-splits" << endl
+              << "\tLocal sort " << ((float)sort_time)/1000 << " msecs" << endl
+              << "\tSent       " << tr.bytes_sent << " bytes" << endl
+              << "\tReceived   " << tr.bytes_received << " bytes" << endl
+              << "\tWait       " << tr.wait_time/1e6 << " msecs (send " << tr.send_time/1e6 << " msecs)" << endl;
+
+        // Check: sorted partitions, in order across the neighbours
+        bool error = !is_sorted(A.begin(), A.end(), comp);
+        T ext;
+        if(r < np-1) tr.send(r+1, &A.back(), sizeof(T));
+        if(r > 0) {
+            tr.recv(r-1, &ext, sizeof(T));
+            error |= comp(A.front(), ext);
+        }
+        error = tr.allreduce_or(error);
+
+        if(out) copy(A.begin(), A.end(), out + lo);
+        if(r == 0) *result = iter;
+
+        // Printed in order of rank
+        if(opt.report) {
+            char token = 0;
+            if(r > 0) tr.recv(r-1, &token, 1);
+            if(r == 0) {
+                if(error) cout << "Not sorted!" << endl;
+                cout << "Total time with " << np << " ranks (" << opt.kind << "): " << ((float)total_time)/1000 << " msecs" << endl
+                     << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
+            }
+            cout << stats.str();
+            cout.flush();
+            if(r < np-1) tr.send(r+1, &token, 1);
+        }
+
+        return error ? -1 : 0;
+    };
+
+    long iter = (spawn_ranks(opt.kind, np, rank_fun, opt.capacity) == 0) ? *result : -1;
+    munmap(result, sizeof(long));
+    return iter;
+}
+
+/*
+ * Sorts 'A' with 'np' ranks: the ranks copy their partition from 'A' (as
+ * inherited by fork) and write the sorted one to a shared mapping, copied
+ * back to 'A' at the end.
+ * Returns the number of iterations, -1 on error
+ */
+template<typename T, typename Compare, typename Alloc>
+long odd_even_dist(vector<T, Alloc> &A, int np, const dist_options &opt) {
+    size_t bytes = max<size_t>(1, A.size()*sizeof(T));
+    T *out = (T *)mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(out == MAP_FAILED) {
+        cout << "Cannot map the result" << endl;
+        return -1;
+    }
+
+    long iter = odd_even_dist_ranks<T, Compare>(A.size(), [&] (long i) { return A[i]; }, out, np, opt);
+    if(iter >= 0) copy(out, out + A.size(), A.begin());
+    munmap(out, bytes);
+    return iter;
+}
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstring>
+
+#include "business_logic.cpp"
+#include "utils.cpp"
+#include "Barriers.cpp"
+#include "ActiveRegion.cpp"
+#include "TaskManager.cpp"
+#include "Affinity.cpp"
+#include "Trace.cpp"
+#include "KernelSelect.cpp"
+#include "Timer.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Dynamic version of the Odd-even Sort (odd-even-par-dyn.cpp), callable
+ * in-process: at each phase the workers take chunks of the array from a
+ * TaskManager and synchronize at the end of the phase.
+ * The options are the ones of the command line of odd-even-par-dyn, parse
+ * reads (and removes) them from argc/argv.
+ */
+struct dyn_options {
+    const char *barrier = "active";             // -b : active, hybrid or tree
+    int spin = HybridBarrier::default_spin;     // -s : pauses before sleeping (hybrid)
+    int C = 0;                                  // -a : chunks of the active region
+    const char *pinning = "none";               // -p : pinning policy (see pin_plan)
+    bool D = false;                             // -d : no master thread
+    const char *trace_path = nullptr;           // -T : Chrome trace file
+    const char *kernel = "default";             // -K : version of sort_couples
+    bool report = true; // Prints the timing lines and the statistics asked for
+
+    void parse(int &argc, char const *argv[]) {
+        barrier = get_option(argc, argv, "-b", barrier);
+        spin = get_option(argc, argv, "-s", spin);
+        C = get_option(argc, argv, "-a", C);
+        pinning = get_option(argc, argv, "-p", pinning);
+        D = get_flag(argc, argv, "-d") || D;
+        trace_path = get_option(argc, argv, "-T", trace_path);
+        kernel = get_option(argc, argv, "-K", kernel);
+    }
+};
+
+/*
+ * CPU and NUMA node of each worker of the dynamic version: the array is
+ * split among the nodes in proportion to their workers, and each worker
+ * touches first a part of the range of its node, the one it takes its
+ * tasks from
+ */
+struct DynPlacement {
+    vector<int> cpus, wnode, node_workers, bounds;
+
+    // Returns false if the pinning policy is unknown
+    bool plan(const char *pinning, int N, int nw) {
+        if(!pin_plan(pinning, nw, cpus)) return false;
+        vector<vector<int>> nodes = numa_nodes();
+        int nn = nodes.size();
+        wnode.assign(nw, 0);
+        node_workers.assign(nn, 0);
+        for(int t=0; t<(int)cpus.size(); t++) wnode[t] = cpu_node(nodes, cpus[t]);
+        for(int t=0; t<nw; t++) node_workers[wnode[t]]++;
+
+        bounds.assign(nn+1, N);
+        for(int n=0, before=0; n<nn; n++) {
+            bounds[n] = (before == nw) ? N : ((long)N*before/nw) & ~1;
+            before += node_workers[n];
+        }
+        return true;
+    }
+
+    // Part of the range of its node of worker 't'
+    void part(int t, int *lo, int *hi) const {
+        int n = wnode[t], k = count(wnode.begin(), wnode.begin()+t, n);
+        long len = bounds[n+1] - bounds[n];
+        *lo = bounds[n] + ((len*k/node_workers[n]) & ~1);
+        *hi = (k == node_workers[n]-1) ? bounds[n+1] : bounds[n] + ((len*(k+1)/node_workers[n]) & ~1);
+    }
+};
+
+/*
+ * Sorts 'A' with 'nw' workers and chunks of 'chunksize' elements (0 =>
+ * adaptive); the workers are pinned with opt.pinning, but 'A' is placed by
+ * the caller (see first_touch_fill and DynPlacement)
+ * Prints the time and the iterations (plus the statistics of -K and -T)
+ * when opt.report is set.
+ * Returns the number of iterations, -1 if an option is not valid
+ */
+template<typename T, typename Compare, typename Alloc>
+long odd_even_par_dyn(vector<T, Alloc> &A, int nw, int chunksize, const dyn_options &opt) {
+    int N = A.size();
+    int spin = opt.spin, C = opt.C;
+    bool D = opt.D;
+    const char *trace_path = opt.trace_path, *kernel = opt.kernel;
+
+    // Chunks must start at the parity of the phase
+    if(chunksize > 0) chunksize = max(2, chunksize + chunksize%2);
+
+    DynPlacement place;
+    if(!place.plan(opt.pinning, N, nw)) return -1;
+
+    // The whole computation is templated on the barrier
+    long result = -1;
+    int ret = dispatch_barrier(opt.barrier, [&] (auto btag) {
+        using Barrier = typename decltype(btag)::type;
+
+        // Statistics
+        unsigned long iter = 0;
+#if STATS
+        mutex print_m; // For mutual exclusive prints
+#endif
+
+        // Version of sort_couples supported by the CPU, or the one chosen
+        // with -K (the first one, with the selection at each phase)
+        KernelSelector<T, Compare> ks;
+        if(!ks.configure(kernel, A.data(), N)) return -1;
+        bool klog = (strcmp(kernel, "default") != 0);
+        vector<KernelLog> logs(nw);
+#if STATS
+        cout << "Kernel: " << sort_couples_name<T, Compare>(ks.fn(ks.initial())) << endl;
+#endif
+
+
+        // Events of the workers, when enabled with -T
+        Tracer trace(nw, trace_path);
+
+        auto start = high_resolution_clock::now();
+
+        // Variable for the stopping condition
+        atomic<int> swapped = 0;
+
+        // Variables and structures for synchronization
+        atomic<bool> terminate = false;
+        Barrier even_barrier = make_barrier<Barrier>(nw, spin);
+        Barrier odd_barrier = make_barrier<Barrier>(nw, spin);
+
+        // Shared data structute for auto-scheduling
+        TaskManager tm(chunksize, N);
+        tm.set_workers(nw, [&] (int t, int *lo, int *hi) { place.part(t, lo, hi); }, place.wnode);
+
+        // Active region tracking
+        ActiveRegion region(N, C);
+        bool track = (C > 0);
+        if(track) tm.set_region(&region);
+
+        // Prepare the tasks of phase 'par' of iteration 'it'
+        auto reset_tasks = [&] (int par, unsigned long it) {
+            if(track) tm.set_phase(par, it);
+            else tm.set_index(par);
+        };
+        reset_tasks(0, 1);
+
+        // A task is a chunk of the part of worker 't' (or stolen from another
+        // worker when it is over) or, when tracking the active region, a
+        // slice of the list of dirty chunks
+        auto get_task = [&] (int t, int *s, int *e) {
+            return (track) ? tm.get_chunks(s, e) : tm.get_task(t, s, e);
+        };
+        auto run_task = [&] (int t, int s, int e, int par, sort_couples_fun<T> fn) {
+            if(!track) {
+                int n = fn(A.data(), s, e);
+                tm.done(t, n);
+                return n;
+            }
+
+            int nswaps = 0;
+            for(int k=s; k<e; k++) {
+                int c = tm.chunk(k), cs, ce;
+                region.bounds(c, par, &cs, &ce);
+                int n = fn(A.data(), cs, ce);
+                region.update(c, par, n);
+                nswaps += n;
+            }
+            return nswaps;
+        };
+
+        // Synchronization of the workers: with a master thread main resets
+        // the barriers and the tasks, in decentralized mode (always with the
+        // tree barrier) it is done by the last worker to arrive, the workers
+        // get the OR of the swaps from the barrier and main is worker 0
+        bool decentral = D || !master_barrier<Barrier>;
+
+        auto phase_sync = [&] (int t) {
+            if constexpr (master_barrier<Barrier>)
+                if(!decentral) return odd_barrier.wait_reset();
+            odd_barrier.wait(t, 0, [&] (unsigned long) {
+#if PRINT
+                cout << "EVEN  ";
+                print_vector(A);
+#endif
+                reset_tasks(1, iter+1);
+            });
+        };
+        auto publish = [&] (int flags) {
+            if(!decentral) swapped |= flags;
+        };
+        // End of an iteration, returns false when the sort is over
+        auto iter_sync = [&] (int t, int flags) {
+            if constexpr (master_barrier<Barrier>) {
+                if(!decentral) {
+                    even_barrier.wait_reset();
+                    return !terminate;
+                }
+            }
+
+            return even_barrier.wait(t, flags, [&] (unsigned long all) {
+                iter++;
+#if PRINT
+                cout << "ODD   ";
+                print_vector(A);
+#endif
+                if(all) reset_tasks(0, iter+1);
+            }) != 0;
+        };
+
+        auto worker_fun = [&] (int t)
+        {
+#if STATS
+            unsigned long even_time = 0, even_runs = 0,       // Even phase statistics
+                          even_overhead = 0, even_swaps = 0;
+            unsigned long odd_time = 0, odd_runs = 0,         // Odd phase statistics
+                          odd_overhead = 0, odd_swaps = 0;
+            unsigned long barrier1_t = 0, barrier2_t = 0, update_t = 0; // Overhead statistics
+
+            unsigned long temp;
+#endif
+            pin_worker(place.cpus, t);
+
+            // Retrieval of a task, traced as well
+            unsigned long ev;
+            auto traced_task = [&] (int t, int *s, int *e) {
+                ev = trace.begin();
+                bool got = get_task(t, s, e);
+                trace.end(t, EV_FETCH, ev, (got) ? *s : N);
+                return got;
+            };
+
+            // Kernel of the next even and odd phase, and couples of the tasks
+            // of the current phase
+            int kern[2] = {ks.initial(), ks.initial()};
+            long couples;
+
+            unsigned long it = 0; // Current iteration
+            unsigned long ph;     // Start of the traced phase
+            int swapped_prv, nswaps, start, end;
+            bool go_on = true;
+            while(go_on) {
+                it++;
+
+                // Even phase
+                nswaps = 0;
+                couples = 0;
+                ph = trace.begin();
+#if STATS
+                {   Timer t_even(&temp);
+#endif
+                    while(traced_task(t, &start, &end)) {
+                        ev = trace.begin();
+#if STATS
+                        { Timer t_scan(&temp);
+#endif
+                        nswaps += run_task(t, start, end, 0, ks.fn(kern[0]));
+                        couples += (track) ? (long)(end-start)*C/2 : (end-start)/2;
+#if STATS
+                        } even_time += temp;
+                        even_runs++;
+#endif
+                        trace.end(t, EV_TASK, ev, start);
+                    }
+                    swapped_prv = nswaps;
+#if STATS
+                }   even_overhead += temp;
+                    even_swaps += nswaps;
+#endif
+                trace.end(t, EV_EVEN, ph, it);
+                if(klog) logs[t].record(it, 0, kern[0]);
+                if(ks.adaptive()) kern[0] = ks.pick(nswaps, couples);
+
+                // Barrier, wait for the master thread (or the last worker) to reset it
+                ev = trace.begin();
+#if STATS
+                {   Timer t_b1(&temp);
+#endif
+                    phase_sync(t);
+#if STATS
+                }   barrier1_t += temp;
+#endif
+                trace.end(t, EV_BARRIER1, ev, it);
+
+                // Odd phase
+                nswaps = 0;
+                couples = 0;
+                ph = trace.begin();
+#if STATS
+                {   Timer t_odd(&temp);
+#endif
+                    while(traced_task(t, &start, &end)) {
+                        ev = trace.begin();
+#if STATS
+                        { Timer t_scan(&temp);
+#endif
+                        nswaps += run_task(t, start, end, 1, ks.fn(kern[1]));
+                        couples += (track) ? (long)(end-start)*C/2 : (end-start)/2;
+#if STATS
+                        } odd_time += temp;
+                        odd_runs++;
+#endif
+                        trace.end(t, EV_TASK, ev, start);
+                    }
+                    swapped_prv |= nswaps;
+#if STATS
+                }   odd_overhead += temp;
+                    odd_swaps += nswaps;
+#endif
+                trace.end(t, EV_ODD, ph, it);
+                if(klog) logs[t].record(it, 1, kern[1]);
+                if(ks.adaptive()) kern[1] = ks.pick(nswaps, couples);
+
+                // Atomicly update the shared variable
+                ev = trace.begin();
+#if STATS
+                {   Timer t_update(&temp);
+#endif
+                    publish(swapped_prv != 0);
+#if STATS
+                }   update_t += temp;
+#endif
+                trace.end(t, EV_UPDATE, ev, it);
+
+                // Barrier, wait for the master thread (main) to reset the barrier
+                // (or for all the workers, with the tree barrier)
+                ev = trace.begin();
+#if STATS
+                {   Timer t_b2(&temp);
+#endif
+                    go_on = iter_sync(t, swapped_prv != 0);
+#if STATS
+                }   barrier2_t += temp;
+#endif
+                trace.end(t, EV_BARRIER2, ev, it);
+            } // End of loop
+
+
+#if STATS
+            {
+                unique_lock<mutex> print_lock(print_m);
+                cout << "Worker " << t << ":" << endl
+                     << "\tAvg even run        " << ((float)even_time)/even_runs/1000 << " usecs ("
+                     << even_swaps/even_runs << " swaps)" << endl
+                     << "\tAvg task retrieve   "
+                     << ((float)even_overhead-even_time)/even_runs/1000 << " usecs" << endl
+                     << "\tAvg even phase      " << ((float)even_time)/iter/1000 << " usecs" << endl
+                     << "\tAvg even scheduling " << ((float)even_overhead-even_time)/iter/1000 << " usecs" << endl
+                     << "\tAvg barrier 1       " << ((float)barrier1_t)/iter/1000 << " usecs" << endl
+                     << "\tAvg odd run         " << ((float)odd_time)/odd_runs/1000 << " usecs ("
+                     << odd_swaps/odd_runs << " swaps)" << endl
+                     << "\tAvg task retrieve   "
+                     << ((float)odd_overhead-odd_time)/odd_runs/1000 << " usecs" << endl
+                     << "\tAvg odd phase       " << ((float)odd_time)/iter/1000 << " usecs" << endl
+                     << "\tAvg odd scheduling  " << ((float)odd_overhead-odd_time)/iter/1000 << " usecs" << endl
+                     << "\tAvg update          " << ((float)update_t)/iter/1000 << " usecs" << endl
+                     << "\tAvg barrier 2       " << ((float)barrier2_t)/iter/1000 << " usecs" << endl << endl;
+            }
+#endif
+
+            return;
+        };
+
+        // Start the workers, in decentralized mode main is worker 0
+        // and the workers terminate by themselves
+        int first = (decentral) ? 1 : 0;
+        vector<thread> workers;
+        for(int i=first; i<nw; i++)
+            workers.emplace_back(worker_fun, i);
+
+        if(decentral) {
+            // main is pinned as worker 0 for the run only
+            cpu_set_t main_set = get_affinity();
+            worker_fun(0);
+            set_affinity(main_set);
+        } else if constexpr (master_barrier<Barrier>) {
+            while(true) {
+                iter++;
+
+                // Wait for the end of even phase
+                odd_barrier.wait_all_nomod();
+#if PRINT
+                cout << "EVEN  ";
+                print_vector(A);
+#endif
+
+                // Reset task manager and barrier
+                reset_tasks(1, iter);
+                odd_barrier.reset();
+
+                // Wait for the end of odd phase
+                even_barrier.wait_all_nomod();
+#if PRINT
+                cout << "ODD   ";
+                print_vector(A);
+#endif
+
+                if(!swapped) break; // Check for termination
+                // Reset task manager and barrier
+                reset_tasks(0, iter+1);
+                swapped = 0;
+                even_barrier.reset();
+            }
+
+            terminate = true; // Send termination signal
+            even_barrier.reset();
+        }
+
+        for(auto &w : workers)
+            w.join();
+
+        auto stop = high_resolution_clock::now();
+        auto total_time = duration_cast<microseconds>(stop - start).count();
+
+
+        if(opt.report) {
+            cout << "Total time with " << nw << " workers: " << ((float)total_time)/1000.0 << " msecs" << endl;
+            cout << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
+#if STATS
+            cout << "Final chunksize: " << tm.chunk_size() << endl;
+#endif
+            if(klog) print_kernel_log(ks, logs, iter);
+        }
+        if(trace.enabled()) {
+            unsigned long events = trace.dump();
+            if(opt.report)
+                cout << "Trace: " << events << " events written to " << trace_path
+                     << " (" << trace.dropped() << " dropped)" << endl;
+        }
+
+        result = iter;
+        return 0;
+    });
+
+    return (ret < 0) ? -1 : result;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <ff/ff.hpp>
+#include <ff/parallel_for.hpp>
+
+#include "business_logic.cpp"
+#include "utils.cpp"
+#include "ActiveRegion.cpp"
+#include "Timer.cpp"
+
+using namespace std;
+
+/*
+ * FastFlow version of the Odd-even Sort (odd-even-ff.cpp), callable
+ * in-process: each phase is a ParallelForReduce over the couples (or over
+ * the chunks of the active region). parse reads (and removes) its options
+ * from argc/argv.
+ * The names of FastFlow are qualified, the header is also included next to
+ * the other engines.
+ */
+struct ff_options {
+    int C = 0;          // -a : chunks of the active region
+    bool report = true; // Prints the timing lines and the statistics asked for
+
+    void parse(int &argc, char const *argv[]) {
+        C = get_option(argc, argv, "-a", C);
+    }
+};
+
+/*
+ * Sorts 'A' with 'nw' workers and the given chunksize (0 => static block,
+ * <0 => static cyclic, >0 => dynamic scheduling), printing the time and the
+ * iterations when opt.report is set.
+ * Returns the number of iterations
+ */
+template<typename T, typename Compare, typename Alloc>
+long odd_even_ff(vector<T, Alloc> &A, int nw, int chunksize, const ff_options &opt) {
+    int N = A.size();
+    int C = opt.C;
+
+    // Statistics
+    unsigned long iter = 0;
+#if STATS
+    unsigned long even_time = 0, odd_time = 0;
+    unsigned long temp;
+#endif
+
+    Compare comp; // Ordering of the elements
+
+    // Variable for the stopping condition
+    int swapped = 1;
+
+    auto body = [&] (const long i, int &s) {
+        if(comp(A[i+1], A[i])) {
+            swap(A[i], A[i+1]);
+            s = 1;
+        }
+    };
+
+    auto reduce = [&] (int &s, const int e) { s |= e; };
+
+    // Active region tracking: the iterations of the loop are the chunks
+    ActiveRegion region(N, C);
+    bool track = (C > 0);
+    int chunk_grain = (chunksize > 0) ? max(1, chunksize/region.chunk_size()) : chunksize;
+    sort_couples_fun<T> sort_fn = select_sort_couples<T, Compare>();
+
+    int par = 0; // Parity of the current phase
+    auto chunk_body = [&] (const long c, int &s) {
+        int n = 0;
+        if(region.dirty(c, par, iter)) {
+            int cs, ce;
+            region.bounds(c, par, &cs, &ce);
+            n = sort_fn(A.data(), cs, ce);
+        }
+        region.update(c, par, n);
+        if(n) s = 1;
+    };
+
+    ff::ParallelForReduce<int> pfr(nw, true);
+    pfr.disableScheduler();
+
+    ff::ffTime(ff::START_TIME);
+
+    int even_end = (N%2 == 0) ? N : N-1;
+    int odd_end = (N%2 == 0) ? N-1 : N;
+
+    while(swapped) {
+        iter++;
+        swapped = 0;
+
+        // Even phase
+#if STATS
+        {   Timer t_even(&temp);
+#endif
+            par = 0;
+            if(track)
+                pfr.parallel_reduce(
+                        swapped, 0,
+                        0, region.chunks(), 1, chunk_grain,
+                        chunk_body, reduce, nw);
+            else
+                pfr.parallel_reduce(
+                        swapped, 0,
+                        0, even_end, 2, chunksize,
+                        body, reduce, nw);
+#if STATS
+        }   even_time += temp;
+#endif
+#if PRINT
+        cout << "EVEN  ";
+        print_vector(A);
+#endif
+
+        // Odd phase
+#if STATS
+        {   Timer t_odd(&temp);
+#endif
+            par = 1;
+            if(track)
+                pfr.parallel_reduce(
+                        swapped, 0,
+                        0, region.chunks(), 1, chunk_grain,
+                        chunk_body, reduce, nw);
+            else
+                pfr.parallel_reduce(
+                        swapped, 0,
+                        1, odd_end, 2, chunksize,
+                        body, reduce, nw);
+#if STATS
+        }   odd_time += temp;
+#endif
+#if PRINT
+        cout << "ODD   ";
+        print_vector(A);
+#endif
+    }
+
+    ff::ffTime(ff::STOP_TIME);
+    auto total_time = ff::ffTime(ff::GET_TIME);
+
+
+    if(opt.report) {
+        cout << "Total time with " << nw << " workers: " << ((float)total_time) << " msecs" << endl;
+        cout << "Iterations: " << iter << " (" << ((float)total_time)/iter*1000 << " usecs per iteration)" << endl;
+#if STATS
+        cout << "Avg even phase  " << ((float)even_time)/iter/1000 << " usecs" << endl
+             << "Avg odd phase   " << ((float)odd_time)/iter/1000 << " usecs" << endl;
+#endif
+    }
+
+    return iter;
+}
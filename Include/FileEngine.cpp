@@ -0,0 +1,238 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "utils.cpp"
+#include "HybridBarrier.cpp"
+#include "Timer.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Block Odd-even Sort of a binary file (odd-even-file.cpp), callable
+ * in-process: the file is sorted in place on a shared memory mapping.
+ * parse reads (and removes) its options from argc/argv.
+ */
+struct file_options {
+    long B = 0;         // -B : elements per block (0 => N/nw, at most 16M)
+    bool report = true; // Prints the timing lines and the statistics asked for
+
+    void parse(int &argc, char const *argv[]) {
+        B = get_option(argc, argv, "-B", (int)B);
+    }
+};
+
+// Major page faults of the process so far
+inline long major_faults() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_majflt;
+}
+
+/*
+ * Sorts the file 'path' of elements of type T with 'nw' workers, printing
+ * the time, the iterations (rounds) and the paging when opt.report is set.
+ * Returns the number of iterations, -1 if the file cannot be mapped or the
+ * result is not sorted
+ */
+template<typename T, typename Compare>
+long odd_even_file(const char *path, int nw, const file_options &opt) {
+    // Mapping of the file
+    int fd = open(path, O_RDWR);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) < 0) {
+        cout << "Cannot open " << path << endl;
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+    if(st.st_size % sizeof(T) != 0) {
+        cout << path << " is not a file of elements of " << sizeof(T) << " bytes ("
+             << st.st_size << " bytes, not a multiple of " << sizeof(T) << ")" << endl;
+        close(fd);
+        return -1;
+    }
+    long N = st.st_size / sizeof(T);
+
+    // Nothing to sort
+    if(N < 2) {
+        close(fd);
+        if(opt.report) {
+            cout << "Total time with " << nw << " workers: 0 msecs" << endl;
+            cout << "Iterations: 0" << endl;
+        }
+        return 0;
+    }
+
+    T *A = (T *)mmap(nullptr, N*sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(A == MAP_FAILED) {
+        cout << "Cannot map " << path << endl;
+        close(fd);
+        return -1;
+    }
+    madvise(A, N*sizeof(T), MADV_SEQUENTIAL);
+
+    // Blocks
+    long B = opt.B;
+    if(B <= 0) B = min((N + nw - 1)/nw, 1L << 24);
+    B = max(B, 1L);
+    long nb = (N + B - 1)/B;
+    nw = max(1L, min((long)nw, nb));
+    auto block_start = [&] (long b) { return min(N, b*B); };
+
+    // Statistics
+    unsigned long iter = 0;
+    atomic<unsigned long> pagein_t = 0; // Max over the workers
+    long faults = major_faults();
+#if STATS
+    mutex print_m; // For mutual exclusive prints
+#endif
+
+    Compare comp; // Ordering of the elements
+
+    auto start = high_resolution_clock::now();
+
+    // Next block (local sort) or couple (rounds) to be taken
+    atomic<long> next = 0;
+    HybridBarrier barrier(nw);
+
+    auto worker_fun = [&] (int t)
+    {
+#if STATS
+        unsigned long sort_time = 0, merge_time = 0;
+        unsigned long merges = 0;
+        unsigned long barrier_t = 0;
+#endif
+        unsigned long temp, touch_time = 0;
+        vector<T> buf(2*B); // Private result of the merge-split
+
+        // Local sort, the block is first read sequentially
+        for(long b=next++; b<nb; b=next++) {
+            long lo = block_start(b), hi = block_start(b+1);
+            {   Timer t_touch(&temp);
+                volatile char sink;
+                for(long i=lo; i<hi; i += 4096/sizeof(T)) sink = *(char *)(A+i);
+                (void)sink;
+            }   touch_time += temp;
+#if STATS
+            {   Timer t_sort(&temp);
+#endif
+                sort(A+lo, A+hi, comp);
+#if STATS
+            }   sort_time += temp;
+#endif
+        }
+
+        unsigned long prev = pagein_t;
+        while(prev < touch_time && !pagein_t.compare_exchange_weak(prev, touch_time)) ;
+
+        barrier.wait(t, 0, [&] (unsigned long) { next = 0; });
+
+        /*
+         * Merge-split of the couple of blocks starting at block 'b',
+         * returns false if they are already in order
+         */
+        auto merge_split = [&] (long b) {
+            long lo = block_start(b), mid = block_start(b+1), hi = block_start(b+2);
+            if(mid == hi || !comp(A[mid], A[mid-1])) return false;
+
+            merge(A+lo, A+mid, A+mid, A+hi, buf.begin(), comp);
+            copy(buf.begin(), buf.begin()+(hi-lo), A+lo);
+            return true;
+        };
+
+        // Rounds, even (couples 0-1, 2-3, ...) and odd (1-2, 3-4, ...)
+        bool go_on = true;
+        int par = 0;
+        unsigned long changed = 0; // Changes in the last even and odd round
+        while(go_on) {
+#if STATS
+            {   Timer t_merge(&temp);
+#endif
+                for(long k=next++; par+2*k < nb-1; k=next++) {
+                    bool c = merge_split(par + 2*k);
+                    changed |= (unsigned long)c << par;
+#if STATS
+                    merges += c;
+#endif
+                }
+#if STATS
+            }   merge_time += temp;
+#endif
+
+#if STATS
+            {   Timer t_b(&temp);
+#endif
+                // After the odd round the last worker checks the termination
+                unsigned long all = barrier.wait(t, (par == 1) ? changed : 0, [&] (unsigned long) {
+                    next = 0;
+                    if(par == 1) iter++;
+                });
+                if(par == 1) {
+                    go_on = (all != 0);
+                    changed = 0;
+                }
+#if STATS
+            }   barrier_t += temp;
+#endif
+            par = 1 - par;
+        }
+
+#if STATS
+        {
+            unique_lock<mutex> print_lock(print_m);
+            cout << "Worker " << t << ":" << endl
+                 << "\tPage-in        " << ((float)touch_time)/1000000 << " msecs" << endl
+                 << "\tLocal sort     " << ((float)sort_time)/1000000 << " msecs" << endl
+                 << "\tAvg merge      " << ((float)merge_time)/iter/1000 << " usecs"
+                 << " (" << merges << " merge-splits)" << endl
+                 << "\tAvg barriers   " << ((float)barrier_t)/iter/1000 << " usecs" << endl << endl;
+        }
+#endif
+    };
+
+    vector<thread> workers;
+    for(int i=1; i<nw; i++)
+        workers.emplace_back(worker_fun, i);
+    worker_fun(0);
+    for(auto &w : workers)
+        w.join();
+
+    auto stop = high_resolution_clock::now();
+    auto total_time = duration_cast<microseconds>(stop - start).count();
+
+    // Write back the dirty pages
+    auto sync_start = high_resolution_clock::now();
+    msync(A, N*sizeof(T), MS_SYNC);
+    auto sync_stop = high_resolution_clock::now();
+    auto pageout_time = duration_cast<microseconds>(sync_stop - sync_start).count();
+
+
+    if(opt.report) {
+        cout << "Total time with " << nw << " workers: " << ((float)total_time)/1000.0 << " msecs" << endl;
+        cout << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
+        cout << "Blocks: " << nb << " of " << B << " elements" << endl;
+        cout << "Page-in: " << ((float)pagein_t)/1000000 << " msecs (" << major_faults() - faults << " major faults)" << endl;
+        cout << "Page-out: " << ((float)pageout_time)/1000.0 << " msecs (msync)" << endl;
+    }
+
+
+    // Just to make sure it works for larger files
+    bool error = !is_sorted(A, A+N, Compare());
+    if(error) cout << "Not sorted!" << endl;
+
+    munmap(A, N*sizeof(T));
+    close(fd);
+    return (error) ? -1 : (long)iter;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+/*
+ * Parallel input generators
+ * The element in position i is a function of (distribution, N, seed, i)
+ * only, computed with a counter-based random number generator (a hash of
+ * the seed and of the counter) instead of a sequential state, so the
+ * positions can be filled by any number of threads, in any order, with the
+ * same result. The random permutations are Feistel networks on the
+ * smallest power of 4 above N, restricted to [0, N) by cycle walking, so
+ * both the permutation and its inverse are computed element by element.
+ * Distributions (the number is optional):
+ *      random     : random permutation of 0..N-1
+ *      sorted, reversed
+ *      iterK      : sortable in at most K iterations, each window of
+ *                   2(K-1) elements is a random permutation of its positions
+ *      nearlyK    : sorted, with K random couples of elements exchanged
+ *                   (default sqrt(N))
+ *      fewK       : K distinct keys (default 16)
+ *      sawtoothK  : K ascending runs (default 16)
+ *      organ      : organ pipe, ascending then descending
+ *      zipfS      : Zipf distribution of exponent S on 1..N (default 1)
+ */
+
+// SplitMix64 finalizer
+inline unsigned long mix64(unsigned long x) {
+    x += 0x9E3779B97F4A7C15ul;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ul;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBul;
+    return x ^ (x >> 31);
+}
+
+// Random number for the counter 'i' of the stream 'seed'
+inline unsigned long counter_rng(unsigned long seed, unsigned long i) {
+    return mix64(mix64(seed) ^ i);
+}
+
+/*
+ * Random permutation of [0, n) and its inverse
+ */
+class FeistelPermutation {
+private:
+    static constexpr int rounds = 4;
+    unsigned long n, key;
+    int half;           // Bits of each half
+    unsigned long mask;
+
+    unsigned long f(int r, unsigned long x) const {
+        return counter_rng(key + r, x) & mask;
+    }
+
+    unsigned long encrypt(unsigned long x) const {
+        unsigned long L = x >> half, R = x & mask;
+        for(int r=0; r<rounds; r++) {
+            unsigned long t = L ^ f(r, R);
+            L = R;
+            R = t;
+        }
+        return (L << half) | R;
+    }
+
+    unsigned long decrypt(unsigned long x) const {
+        unsigned long L = x >> half, R = x & mask;
+        for(int r=rounds-1; r>=0; r--) {
+            unsigned long t = R ^ f(r, L);
+            R = L;
+            L = t;
+        }
+        return (L << half) | R;
+    }
+
+public:
+    FeistelPermutation(unsigned long n, unsigned long seed) : n(n), key(mix64(seed)) {
+        int bits = 1;
+        while(bits < 64 && (1ul << bits) < n) bits++;
+        half = (bits + 1)/2;
+        mask = (1ul << half) - 1;
+    }
+
+    unsigned long operator()(unsigned long i) const {
+        do i = encrypt(i); while(i >= n);
+        return i;
+    }
+
+    unsigned long inverse(unsigned long i) const {
+        do i = decrypt(i); while(i >= n);
+        return i;
+    }
+};
+
+class InputGenerator {
+private:
+    enum Kind { RANDOM, SORTED, REVERSED, ITER, NEARLY, FEW, SAWTOOTH, ORGAN, ZIPF, UNKNOWN };
+
+    Kind kind = UNKNOWN;
+    long N;
+    unsigned long seed;
+    double param;
+    FeistelPermutation perm;
+
+public:
+    InputGenerator(const char *name, long N, unsigned long seed) : N(N), seed(seed), perm(max(N, 1L), seed) {
+        static const pair<const char *, Kind> kinds[] = {
+            {"random", RANDOM}, {"sorted", SORTED}, {"reversed", REVERSED}, {"iter", ITER},
+            {"nearly", NEARLY}, {"few", FEW}, {"sawtooth", SAWTOOTH}, {"organ", ORGAN}, {"zipf", ZIPF}
+        };
+
+        // Name followed by the optional parameter
+        size_t len = 0;
+        while(name[len] && !isdigit(name[len]) && name[len] != '.') len++;
+        string prefix(name, len);
+        param = (name[len]) ? atof(name+len) : -1;
+
+        for(auto &k : kinds)
+            if(prefix == k.first) kind = k.second;
+
+        if(kind == ITER && param < 1) param = 1;
+        if(kind == NEARLY) param = min((double)N/2, (param < 0) ? floor(sqrt((double)N)) : param);
+        if((kind == FEW || kind == SAWTOOTH) && param < 1) param = 16;
+        if(kind == ZIPF && param < 0) param = 1;
+        if(kind == UNKNOWN) cout << "Unknown input distribution " << name << endl;
+    }
+
+    bool valid() const {
+        return kind != UNKNOWN;
+    }
+
+    // Element in position 'i'
+    long operator()(long i) const {
+        switch(kind) {
+        case RANDOM:   return perm(i);
+        case SORTED:   return i;
+        case REVERSED: return N-1-i;
+        case ITER: {
+            // At most 2(K-1) phases in a window, the windows do not interact
+            long W = 2*((long)param - 1);
+            if(W <= 1) return i;
+            long w = i/W, lo = w*W;
+            FeistelPermutation local(min(W, N-lo), counter_rng(seed, w));
+            return lo + local(i-lo);
+        }
+        case NEARLY: {
+            // The couples (perm(2j), perm(2j+1)) for j < K are exchanged
+            long j = perm.inverse(i);
+            return (j < 2*(long)param) ? (long)perm(j ^ 1) : i;
+        }
+        case FEW:      return counter_rng(seed, i) % (unsigned long)param;
+        case SAWTOOTH: return i % max(1L, (long)ceil(N/param));
+        case ORGAN:    return (i < (N+1)/2) ? i : N-1-i;
+        case ZIPF: {
+            // Inverse of the (continuous) distribution function
+            double u = (counter_rng(seed, i) >> 11) * 0x1.0p-53;
+            double s = param, k;
+            if(fabs(s - 1) < 1e-9) k = pow((double)N, u);
+            else k = pow(u*(pow((double)N, 1-s) - 1) + 1, 1/(1-s));
+            return min(N, max(1L, (long)k));
+        }
+        default:       return 0;
+        }
+    }
+};
+
+/*
+ * Fills 'v' with the distribution 'name' on 'nw' threads (0 => all the
+ * cores); returns false if the name is unknown
+ */
+template<typename T, typename Alloc>
+bool generate_input(vector<T, Alloc> &v, const char *name, unsigned long seed, int nw = 0) {
+    InputGenerator gen(name, v.size(), seed);
+    if(!gen.valid()) return false;
+
+    long N = v.size();
+    if(nw <= 0) nw = max(1u, thread::hardware_concurrency());
+    nw = max(1L, min((long)nw, N/4096 + 1));
+
+    vector<thread> threads;
+    for(int t=0; t<nw; t++)
+        threads.emplace_back([&, t] {
+            long lo = N*t/nw, hi = N*(t+1)/nw;
+            for(long i=lo; i<hi; i++) v[i] = T(gen(i));
+        });
+    for(auto &th : threads) th.join();
+    return true;
+}
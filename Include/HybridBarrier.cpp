@@ -0,0 +1,125 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Barrier with the same interface of ActiveBarrier, that does not burn a
+ * core when the threads are more than the cores: waiting threads spin with
+ * a pause instruction, with an exponentially growing number of pauses
+ * between two checks, and after 'spin' pauses go to sleep on a futex.
+ * The counter sits on its own cache line.
+ */
+class HybridBarrier {
+private:
+    alignas(64) atomic<int> count;
+    alignas(64) atomic<int> sleepers; // Threads sleeping (or about to) on the futex
+    int reset_value;
+    int spin;
+
+    // Used only by wait(), where the last thread to arrive resets the barrier
+    alignas(64) atomic<int> generation; // Number of completed barriers
+    atomic<unsigned long> flags_or;
+    unsigned long result;
+
+    static const int max_delay = 1024; // Maximum pauses between two checks
+
+    // Wake up all the threads sleeping on 'word', if any
+    void wake(atomic<int> &word) {
+        if(sleepers > 0)
+            syscall(SYS_futex, (int *)&word, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    // Wait until 'cond(word)' holds
+    template<typename Cond>
+    void wait_until(atomic<int> &word, Cond cond) {
+        long spent = 0;
+        int delay = 1;
+
+        while(!cond(word)) {
+            if(spin < 0 || spent < spin) {
+                for(int i=0; i<delay; i++) _mm_pause();
+                spent += delay;
+                delay = min(2*delay, max_delay);
+                continue;
+            }
+
+            // Sleep only if the counter did not change since it was checked
+            sleepers++;
+            int v = word;
+            if(!cond(v))
+                syscall(SYS_futex, (int *)&word, FUTEX_WAIT_PRIVATE, v, nullptr, nullptr, 0);
+            sleepers--;
+        }
+    }
+
+public:
+    static const int default_spin = 1 << 14;
+
+    // Initialize the barrier, 'spin' is the number of pauses before
+    // sleeping (0 => sleep immediately, <0 => never sleep)
+    HybridBarrier(int v, int s = default_spin) : reset_value(v), spin(s) {
+        count = v;
+        sleepers = 0;
+        generation = 0;
+        flags_or = 0;
+    }
+
+    // Reset the barrier's value
+    void reset() {
+        count = reset_value;
+        wake(count);
+    }
+
+    // Wait until the barrier is resetted
+    void wait_reset() {
+        if(--count == 0) wake(count);
+        wait_until(count, [&] (int c) { return c == reset_value; });
+    }
+
+    // Classical barrier wait
+    void wait_all() {
+        if(--count == 0) wake(count);
+        wait_until(count, [] (int c) { return c <= 0; });
+    }
+
+    // Wait at the barrier without modifying its value
+    void wait_all_nomod() {
+        wait_until(count, [] (int c) { return c <= 0; });
+    }
+
+    /*
+     * Barrier wait without a master thread: the last thread to arrive runs
+     * 'complete(all)', resets the barrier and releases the others
+     * Returns the OR of the flags of all the threads
+     */
+    template<typename F>
+    unsigned long wait(int, unsigned long flags, F complete) {
+        int g = generation;
+        if(flags) flags_or |= flags;
+
+        if(--count > 0) {
+            wait_until(generation, [&] (int v) { return v != g; });
+            return result;
+        }
+
+        result = flags_or.exchange(0);
+        count = reset_value;
+        complete(result);
+        generation++;
+        wake(generation);
+        return result;
+    }
+
+    unsigned long wait(int t, unsigned long flags) {
+        return wait(t, flags, [] (unsigned long) {});
+    }
+};
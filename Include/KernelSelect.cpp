@@ -0,0 +1,209 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <x86intrin.h>
+
+#include "business_logic.cpp"
+
+using namespace std;
+
+/*
+ * Choice of the version of sort_couples (the kernel)
+ * The classical version is fast when its branch is predictable, i.e. when
+ * almost no couple (or almost every couple) is swapped, the branchless and
+ * the vectorized ones cost the same whatever the data. At startup each
+ * candidate is timed on arrays with a few densities of swaps (calibration),
+ * then the kernel of a phase is the fastest one for the nearest density:
+ *      default    : the one of select_sort_couples, no calibration
+ *      scalar, branchless, simd : always the given one
+ *      run        : a single kernel, for the density of the initial problem
+ *      phase      : each worker picks the kernel of each phase from the
+ *                   swaps of its previous phase of the same parity
+ */
+template<typename T, typename Compare = less<T>>
+class KernelSelector {
+private:
+    struct Kernel {
+        const char *name;
+        sort_couples_fun<T> fn;
+    };
+
+    // Swaps per couple of the calibration arrays
+    static constexpr double densities[] = {0, 1.0/256, 1.0/32, 1.0/8, 1.0/2};
+    static constexpr int ND = sizeof(densities)/sizeof(densities[0]);
+
+    vector<Kernel> kernels;
+    vector<vector<double>> cost; // Cycles per couple, for each density and kernel
+    int best[ND] = {};
+    int first = 0;               // Kernel of the first phases
+    bool per_phase = false;
+
+    int nearest(double d) const {
+        int b = 0;
+        for(int i=1; i<ND; i++)
+            if(fabs(log2(d + 1.0/1024) - log2(densities[i] + 1.0/1024)) <
+               fabs(log2(d + 1.0/1024) - log2(densities[b] + 1.0/1024))) b = i;
+        return b;
+    }
+
+public:
+    KernelSelector() {
+        kernels.push_back({"scalar", sort_couples<T, Compare>});
+        kernels.push_back({"branchless", sort_couples_branchless<T, Compare>});
+
+        sort_couples_fun<T> def = select_sort_couples<T, Compare>();
+        if(def != kernels[0].fn && def != kernels[1].fn)
+            kernels.push_back({"simd", def});
+        for(int k=0; k<size(); k++)
+            if(kernels[k].fn == def) first = k;
+    }
+
+    int size() const {
+        return kernels.size();
+    }
+
+    sort_couples_fun<T> fn(int k) const {
+        return kernels[k].fn;
+    }
+
+    const char *name(int k) const {
+        // The vectorized one is named after its instruction set
+        return (k == 2) ? sort_couples_name<T, Compare>(kernels[k].fn) : kernels[k].name;
+    }
+
+    /*
+     * Times each kernel on 'n' elements for each density, and keeps the
+     * fastest one (best of 'reps' runs)
+     */
+    void calibrate(int n = 1 << 14, int reps = 5) {
+        vector<T> base(n), buf(n);
+        minstd_rand gen(42);
+        cost.assign(ND, vector<double>(size(), 0));
+
+        for(int b=0; b<ND; b++) {
+            // Sorted array with a fraction of the even couples inverted
+            vector<int> v(n);
+            iota(v.begin(), v.end(), 0);
+            for(int i=0; i+1<n; i+=2)
+                if(gen() < densities[b]*minstd_rand::max()) swap(v[i], v[i+1]);
+            for(int i=0; i<n; i++) base[i] = T(v[i]);
+
+            for(int k=0; k<size(); k++) {
+                unsigned long min_t = ~0ul;
+                for(int r=0; r<reps; r++) {
+                    copy(base.begin(), base.end(), buf.begin());
+                    unsigned long t0 = __rdtsc();
+                    kernels[k].fn(buf.data(), 0, n);
+                    min_t = min(min_t, (unsigned long)(__rdtsc() - t0));
+                }
+                cost[b][k] = (double)min_t/(n/2);
+            }
+            best[b] = min_element(cost[b].begin(), cost[b].end()) - cost[b].begin();
+        }
+    }
+
+    /*
+     * Sets the policy, returns false if 'mode' is unknown; with 'run' the
+     * density is measured on the even couples of 'A'
+     */
+    bool configure(const char *mode, const T *A, int n) {
+        if(strcmp(mode, "default") == 0) return true;
+
+        for(int k=0; k<size(); k++) {
+            if(strcmp(mode, kernels[k].name) == 0) {
+                first = k;
+                return true;
+            }
+        }
+
+        if(strcmp(mode, "run") == 0 || strcmp(mode, "phase") == 0) {
+            calibrate();
+            Compare comp;
+            int swaps = 0;
+            for(int i=0; i+1<n; i+=2)
+                swaps += comp(A[i+1], A[i]);
+            first = pick(swaps, n/2);
+            per_phase = (strcmp(mode, "phase") == 0);
+            return true;
+        }
+
+        cout << "Unknown kernel " << mode << endl;
+        return false;
+    }
+
+    // True if the kernel changes at each phase
+    bool adaptive() const {
+        return per_phase;
+    }
+
+    // Kernel of the first phase
+    int initial() const {
+        return first;
+    }
+
+    // Kernel for a phase with 'swaps' out of 'couples'
+    int pick(long swaps, long couples) const {
+        if(cost.empty()) return first;
+        return best[nearest((couples > 0) ? (double)swaps/couples : 0)];
+    }
+
+    void print_calibration() const {
+        if(cost.empty()) return;
+        cout << "Kernel calibration (cycles per couple):" << endl;
+        for(int b=0; b<ND; b++) {
+            cout << "\tdensity " << densities[b] << ":";
+            for(int k=0; k<size(); k++)
+                cout << " " << name(k) << " " << cost[b][k];
+            cout << " => " << name(best[b]) << endl;
+        }
+    }
+};
+
+/*
+ * Kernels run by a worker: phases run with each kernel, and the iterations
+ * at which the kernel changed, for each parity
+ */
+struct KernelLog {
+    vector<unsigned long> phases;
+    vector<pair<unsigned long, int>> runs[2]; // (first iteration, kernel)
+
+    void record(unsigned long it, int par, int k) {
+        if((int)phases.size() <= k) phases.resize(k+1, 0);
+        phases[k]++;
+        if(runs[par].empty() || runs[par].back().second != k)
+            runs[par].push_back({it, k});
+    }
+};
+
+/*
+ * Prints which kernel ran when, for each worker; the iterations of a run go
+ * up to the start of the next one (or to 'iter')
+ */
+template<typename Selector>
+void print_kernel_log(const Selector &ks, const vector<KernelLog> &logs, unsigned long iter) {
+    ks.print_calibration();
+    for(int t=0; t<(int)logs.size(); t++) {
+        const KernelLog &log = logs[t];
+        cout << "Worker " << t << " kernels:";
+        for(int k=0; k<(int)log.phases.size(); k++)
+            if(log.phases[k]) cout << " " << ks.name(k) << " " << log.phases[k] << " phases";
+        cout << endl;
+
+        for(int par=0; par<2; par++) {
+            cout << ((par == 0) ? "\teven:" : "\todd: ");
+            auto &runs = log.runs[par];
+            for(size_t r=0; r<runs.size(); r++) {
+                unsigned long last = (r+1 < runs.size()) ? runs[r+1].first-1 : iter;
+                cout << " " << ks.name(runs[r].second) << " " << runs[r].first << "-" << last;
+            }
+            cout << endl;
+        }
+    }
+}
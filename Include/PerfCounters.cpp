@@ -0,0 +1,171 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+
+/*
+ * Hardware performance counters of a thread (perf_event_open)
+ * The counters are opened as a group by the thread to be measured and read
+ * with a single system call at the boundaries of the regions (phases,
+ * barriers): mark(r) adds what was counted since the previous mark to the
+ * totals of region 'r'. The counters that the kernel or the CPU do not
+ * provide (e.g. in a virtual machine, or with perf_event_paranoid > 2) are
+ * left out and reported as unavailable; when none can be opened mark()
+ * does nothing.
+ */
+
+enum PerfCounter { PC_CYCLES, PC_INSTRUCTIONS, PC_LLC_MISSES, PC_BRANCH_MISSES, PC_COUNT };
+
+class alignas(64) PerfCounters {
+private:
+    static constexpr unsigned long configs[PC_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    int fd[PC_COUNT];   // -1 when not available
+    int slot[PC_COUNT]; // Position of the counter in the group read
+    bool has[PC_COUNT] = {};
+    int nopen = 0;
+    int leader = -1;
+    string err;
+
+    array<unsigned long, PC_COUNT> last{};
+    vector<array<unsigned long, PC_COUNT>> totals;
+
+    // Current values of the counters
+    array<unsigned long, PC_COUNT> sample() {
+        array<unsigned long, PC_COUNT> v{};
+        unsigned long buf[1 + PC_COUNT];
+        if(read(fd[leader], buf, sizeof(buf)) < (ssize_t)sizeof(unsigned long)) return last;
+        for(int c=0; c<PC_COUNT; c++)
+            if(fd[c] >= 0) v[c] = buf[1 + slot[c]];
+        return v;
+    }
+
+public:
+    PerfCounters(int nregions = 4) : totals(nregions) {
+        for(int c=0; c<PC_COUNT; c++) fd[c] = -1;
+    }
+
+    ~PerfCounters() {
+        close();
+    }
+
+    /*
+     * Opens the counters for the calling thread, returns false if none of
+     * them is available
+     */
+    bool open() {
+        for(int c=0; c<PC_COUNT; c++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[c];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.disabled = (leader < 0);
+
+            fd[c] = syscall(SYS_perf_event_open, &attr, 0, -1, (leader < 0) ? -1 : fd[leader], 0);
+            if(fd[c] < 0) {
+                if(err.empty()) err = strerror(errno);
+                continue;
+            }
+            if(leader < 0) leader = c;
+            slot[c] = nopen++;
+            has[c] = true;
+        }
+        if(leader < 0) return false;
+
+        ioctl(fd[leader], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fd[leader], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        last = sample();
+        return true;
+    }
+
+    void close() {
+        for(int c=0; c<PC_COUNT; c++) {
+            if(fd[c] >= 0) ::close(fd[c]);
+            fd[c] = -1;
+        }
+        leader = -1;
+    }
+
+    bool ok() const {
+        return nopen > 0;
+    }
+
+    bool available(int c) const {
+        return has[c];
+    }
+
+    // Reason why (some of) the counters could not be opened
+    const string &error() const {
+        return err;
+    }
+
+    // Starts counting for the next region
+    void start() {
+        if(leader >= 0) last = sample();
+    }
+
+    // Ends region 'r', the next one starts here
+    void mark(int r) {
+        if(leader < 0) return;
+        array<unsigned long, PC_COUNT> now = sample();
+        for(int c=0; c<PC_COUNT; c++)
+            totals[r][c] += now[c] - last[c];
+        last = now;
+    }
+
+    unsigned long total(int r, int c) const {
+        return totals[r][c];
+    }
+};
+
+/*
+ * Prints the counters of each worker for each region, averaged on 'n'
+ * (e.g. the iterations)
+ */
+void print_perf_counters(const vector<PerfCounters> &pcs, const vector<const char *> &regions, unsigned long n) {
+    int nw = pcs.size();
+    int nok = 0;
+    for(auto &pc : pcs) nok += pc.ok();
+    if(nok == 0) {
+        cout << "Hardware counters unavailable";
+        if(nw > 0 && !pcs[0].error().empty()) cout << ": " << pcs[0].error();
+        cout << endl;
+        return;
+    }
+
+    n = max(n, 1ul);
+    auto value = [&] (const PerfCounters &pc, int r, int c) {
+        return (pc.available(c)) ? to_string(pc.total(r, c)/n) : string("n/a");
+    };
+
+    cout << "Hardware counters (per iteration):" << endl;
+    for(int t=0; t<nw; t++) {
+        const PerfCounters &pc = pcs[t];
+        cout << "Worker " << t << ":" << endl;
+        for(int r=0; r<(int)regions.size(); r++) {
+            cout << "\t" << regions[r] << "\t" << value(pc, r, PC_CYCLES) << " cycles, "
+                 << value(pc, r, PC_INSTRUCTIONS) << " instructions";
+            if(pc.available(PC_CYCLES) && pc.available(PC_INSTRUCTIONS) && pc.total(r, PC_CYCLES) > 0)
+                cout << " (" << (float)pc.total(r, PC_INSTRUCTIONS)/pc.total(r, PC_CYCLES) << " IPC)";
+            cout << ", " << value(pc, r, PC_LLC_MISSES) << " LLC misses, "
+                 << value(pc, r, PC_BRANCH_MISSES) << " branch misses" << endl;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Machine profile written by odd-even-tune: the number of workers and the
+ * chunksize tuned on this host for each element type and range of sizes.
+ * It is a text file, one entry per line
+ *
+ *      # type lo hi nw chunksize fixed_chunksize
+ *      int 0 65536 2 0 1024
+ *
+ * for the sizes lo <= N < hi. 'chunksize' is the best one for
+ * odd-even-par-dyn (0 => adaptive), 'fixed_chunksize' the best fixed one,
+ * used by odd-even-ff. The file is odd-even-<hostname>.profile in the current
+ * directory, or the one named by the ODD_EVEN_PROFILE environment variable.
+ */
+
+struct ProfileEntry {
+    string type;
+    long lo, hi;
+    int nw, chunksize, fixed_chunksize;
+};
+
+string profile_path() {
+    const char *env = getenv("ODD_EVEN_PROFILE");
+    if(env && *env) return env;
+
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host)-1);
+    return string("odd-even-") + host + ".profile";
+}
+
+vector<ProfileEntry> read_profile(const string &path) {
+    vector<ProfileEntry> entries;
+    ifstream in(path);
+    string line;
+    while(getline(in, line)) {
+        if(line.empty() || line[0] == '#') continue;
+        istringstream ls(line);
+        ProfileEntry e;
+        if(ls >> e.type >> e.lo >> e.hi >> e.nw >> e.chunksize >> e.fixed_chunksize)
+            entries.push_back(e);
+    }
+    return entries;
+}
+
+bool write_profile(const string &path, const vector<ProfileEntry> &entries) {
+    ofstream out(path);
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host)-1);
+
+    out << "# odd-even-sort machine profile of " << host << ", written by odd-even-tune" << endl
+        << "# type lo hi nw chunksize fixed_chunksize" << endl;
+    for(auto &e : entries)
+        out << e.type << " " << e.lo << " " << e.hi << " " << e.nw << " "
+            << e.chunksize << " " << e.fixed_chunksize << endl;
+    return (bool)out;
+}
+
+/*
+ * Entry of the profile for 'type' and 'N': the one whose range contains N,
+ * or the nearest one. Returns false if the profile has no entry for 'type'
+ */
+bool profile_lookup(const char *type, long N, ProfileEntry *found) {
+    long best = LONG_MAX;
+    for(auto &e : read_profile(profile_path())) {
+        if(e.type != type) continue;
+        long dist = (N < e.lo) ? e.lo - N : (N >= e.hi) ? N - e.hi + 1 : 0;
+        if(dist < best) {
+            best = dist;
+            *found = e;
+        }
+    }
+    return best != LONG_MAX;
+}
+
+/*
+ * Workers and chunksize of an engine given as "auto" on the command line:
+ * from the profile when it has an entry, the available cores and adaptive
+ * chunks otherwise. 'fixed' selects the fixed chunksize (odd-even-ff)
+ */
+void profile_settings(const char *type, long N, bool auto_nw, bool auto_chunk, bool fixed,
+                      int *nw, int *chunksize) {
+    if(!auto_nw && !auto_chunk) return;
+
+    ProfileEntry e;
+    if(profile_lookup(type, N, &e)) {
+        if(auto_nw) *nw = e.nw;
+        if(auto_chunk) *chunksize = (fixed) ? e.fixed_chunksize : e.chunksize;
+        cout << "Profile " << profile_path() << ": " << *nw << " workers, chunksize " << *chunksize << endl;
+    } else {
+        if(auto_nw) *nw = max(1u, thread::hardware_concurrency());
+        if(auto_chunk) *chunksize = 0;
+        cout << "No profile entry for " << type << " in " << profile_path() << ", using "
+             << *nw << " workers, chunksize " << *chunksize << endl;
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "business_logic.cpp"
+#include "utils.cpp"
+#include "ActiveRegion.cpp"
+#include "Timer.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Sequential version of the Odd-even Sort (odd-even-seq.cpp), callable
+ * in-process. parse reads (and removes) its options from argc/argv.
+ */
+struct seq_options {
+    int C = 0;          // -a : chunks of the active region
+    bool report = true; // Prints the timing lines and the statistics asked for
+
+    void parse(int &argc, char const *argv[]) {
+        C = get_option(argc, argv, "-a", C);
+    }
+};
+
+/*
+ * Sorts 'A', printing the time and the iterations when opt.report is set.
+ * Returns the number of iterations
+ */
+template<typename T, typename Compare, typename Alloc>
+long odd_even_seq(vector<T, Alloc> &A, const seq_options &opt) {
+    int N = A.size();
+    int C = opt.C;
+
+    // Statistics
+    unsigned long iter = 0;
+#if STATS
+    unsigned long even_time = 0, even_swaps = 0; // Statistics for even phase
+    unsigned long odd_time = 0, odd_swaps = 0;   // Statistics for odd phase
+
+    unsigned long temp;
+#endif
+
+    // Version of sort_couples supported by the CPU
+    sort_couples_fun<T> sort_fn = select_sort_couples<T, Compare>();
+#if STATS
+    if(opt.report) cout << "Kernel: " << sort_couples_name<T, Compare>(sort_fn) << endl;
+#endif
+
+    // Active region tracking
+    ActiveRegion region(N, C);
+    bool track = (C > 0);
+    auto scan = [&] (int s, int e) { return sort_fn(A.data(), s, e); };
+
+
+    auto start = high_resolution_clock::now();
+
+    // Ending index for the two phases
+    int even_end = (N%2 == 0) ? N : N-1;
+    int odd_end = (N%2 == 0) ? N-1 : N;
+
+    int swapped = 1;
+    int nswaps;
+    while(swapped) {
+        iter++;
+
+        // Even phase
+#if STATS
+        {   Timer t_even(&temp);
+#endif
+            nswaps = (track) ? region.scan(0, region.chunks(), 0, iter, scan)
+                             : sort_fn(A.data(), 0, even_end);
+#if STATS
+        }   even_time += temp;
+            even_swaps += nswaps;
+#endif
+            swapped = nswaps;
+#if PRINT
+        cout << "EVEN  ";
+        print_vector(A);
+#endif
+    
+        // Odd phase
+#if STATS
+        {   Timer t_odd(&temp);
+#endif
+            nswaps = (track) ? region.scan(0, region.chunks(), 1, iter, scan)
+                             : sort_fn(A.data(), 1, odd_end);
+#if STATS
+        }   odd_time += temp;
+            odd_swaps += nswaps;
+#endif
+            swapped |= nswaps;
+#if PRINT
+        cout << "ODD   ";
+        print_vector(A);
+#endif
+    }
+
+    auto stop = high_resolution_clock::now();
+    auto total_time = duration_cast<microseconds>(stop - start).count();
+
+
+    if(opt.report) {
+        cout << "Total time: " << ((float)total_time)/1000.0 << " msecs" << endl
+             << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs/iter)" << endl;
+#if STATS
+        cout << "Avg even phase " << ((float)even_time)/iter/1000 << " usecs"
+             << " (" << ((float)even_time)/iter/(N/2) << " nsecs/function exec)"
+             << " (" << even_swaps/iter << " swaps)" << endl
+             << "Avg odd phase  " << ((float)odd_time)/iter/1000 << " usecs"
+             << " (" << ((float)odd_time)/iter/(N/2) << " nsecs/function exec)"
+             << " (" << odd_swaps/iter << " swaps)" << endl;
+#endif
+    }
+
+    return iter;
+}
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstring>
+
+#include "business_logic.cpp"
+#include "utils.cpp"
+#include "Barriers.cpp"
+#include "ActiveRegion.cpp"
+#include "Affinity.cpp"
+#include "Trace.cpp"
+#include "PerfCounters.cpp"
+#include "KernelSelect.cpp"
+#include "Timer.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Static version of the Odd-even Sort (odd-even-par-static.cpp), callable
+ * in-process: the array is split in one block per worker, the same in every
+ * iteration, and the workers synchronize at the end of each phase.
+ * The options are the ones of the command line of odd-even-par-static,
+ * parse reads (and removes) them from argc/argv.
+ */
+struct static_options {
+    const char *barrier = "active";             // -b : active, hybrid or tree
+    int spin = HybridBarrier::default_spin;     // -s : pauses before sleeping (hybrid)
+    int K = 0;                                  // -k : phases between two barriers
+    int C = 0;                                  // -a : chunks of the active region
+    const char *pinning = "none";               // -p : pinning policy (see pin_plan)
+    bool D = false;                             // -d : no master thread
+    const char *trace_path = nullptr;           // -T : Chrome trace file
+    bool H = false;                             // -H : hardware counters
+    const char *kernel = "default";             // -K : version of sort_couples
+    bool report = true; // Prints the timing lines and the statistics asked for
+
+    void parse(int &argc, char const *argv[]) {
+        barrier = get_option(argc, argv, "-b", barrier);
+        spin = get_option(argc, argv, "-s", spin);
+        K = get_option(argc, argv, "-k", K);
+        C = get_option(argc, argv, "-a", C);
+        pinning = get_option(argc, argv, "-p", pinning);
+        D = get_flag(argc, argv, "-d") || D;
+        trace_path = get_option(argc, argv, "-T", trace_path);
+        H = get_flag(argc, argv, "-H") || H;
+        kernel = get_option(argc, argv, "-K", kernel);
+    }
+};
+
+/*
+ * Sorts 'A' with 'nw' workers; the workers are pinned with opt.pinning,
+ * but 'A' is placed by the caller (see first_touch_fill and even_partition)
+ * Prints the time and the iterations (plus the statistics of -K, -H and
+ * -T) when opt.report is set.
+ * Returns the number of iterations, -1 if an option is not valid
+ */
+template<typename T, typename Compare, typename Alloc>
+long odd_even_par_static(vector<T, Alloc> &A, int nw, const static_options &opt) {
+    int N = A.size();
+    int spin = opt.spin, C = opt.C;
+    bool D = opt.D, H = opt.H;
+    const char *trace_path = opt.trace_path, *kernel = opt.kernel;
+
+    // CPU of each worker
+    vector<int> cpus;
+    if(!pin_plan(opt.pinning, nw, cpus)) return -1;
+
+    // K must be even, so that each block of phases starts with an even one,
+    // and at most 128, so that the swaps of the K/2 iterations fit a mask
+    int K = opt.K;
+    if(K > 0) K = min(K + K%2, 128);
+
+    // The whole computation is templated on the barrier
+    long result = -1;
+    int ret = dispatch_barrier(opt.barrier, [&] (auto btag) {
+        using Barrier = typename decltype(btag)::type;
+
+        // Statistics
+        unsigned long iter = 0;
+#if STATS
+        mutex print_m; // For mutual exclusive prints
+#endif
+
+        // Block of each worker, same partition as the even phase
+        auto block = [&] (int t, int *lo, int *hi) {
+            even_partition(N, nw, t, lo, hi);
+        };
+
+        // Version of sort_couples supported by the CPU, or the one chosen
+        // with -K (the first one, with the selection at each phase)
+        KernelSelector<T, Compare> ks;
+        if(!ks.configure(kernel, A.data(), N)) return -1;
+        sort_couples_fun<T> sort_fn = ks.fn(ks.initial());
+        bool klog = (strcmp(kernel, "default") != 0);
+        vector<KernelLog> logs(nw);
+#if STATS
+        cout << "Kernel: " << sort_couples_name<T, Compare>(sort_fn) << endl;
+#endif
+
+
+        // Events of the workers, when enabled with -T
+        Tracer trace(nw, trace_path);
+
+        // Hardware counters of the workers, when enabled with -H, for the
+        // regions between two marks (the first phase or copy, the first
+        // barrier, the second phase or the K phases, the update and the
+        // second barrier)
+        vector<PerfCounters> counters(H ? nw : 0);
+        auto mark = [&] (int t, int r) {
+            if(H) counters[t].mark(r);
+        };
+
+        auto start = high_resolution_clock::now();
+
+        // Variable for the stopping condition, one bit per iteration
+        // (K/2 iterations with temporal blocking)
+        atomic<unsigned long> swapped = 0;
+
+        // Iterations between two checks, and the mask when all of them swapped
+        int block_iter = max(1, K/2);
+        unsigned long full_mask = (block_iter == 64) ? ~0ul : (1ul << block_iter) - 1;
+
+        // Variables and structures for synchronization
+        atomic<bool> terminate = false;
+        Barrier even_barrier = make_barrier<Barrier>(nw, spin);
+        Barrier odd_barrier = make_barrier<Barrier>(nw, spin);
+
+        // Synchronization of the workers: with a master thread main resets
+        // the barriers and checks the termination, in decentralized mode
+        // (always with the tree barrier) the workers get the OR of the swaps
+        // from the barrier itself, and main is worker 0
+        bool decentral = D || !master_barrier<Barrier>;
+
+        auto phase_sync = [&] (int t) {
+            if constexpr (master_barrier<Barrier>)
+                if(!decentral) return odd_barrier.wait_all();
+            odd_barrier.wait(t, 0);
+        };
+        auto publish = [&] (unsigned long flags) {
+            if(!decentral) swapped |= flags;
+        };
+        // End of an iteration (or block), returns false when the sort is over
+        auto iter_sync = [&] (int t, unsigned long flags) {
+            if constexpr (master_barrier<Barrier>) {
+                if(!decentral) {
+                    even_barrier.wait_reset();
+                    return !terminate;
+                }
+            }
+
+            // The last thread to arrive counts the iterations, the first
+            // one without swaps is the one that stops the sort
+            unsigned long all = even_barrier.wait(t, flags, [&] (unsigned long all) {
+                iter += (all == full_mask) ? block_iter : __builtin_ctzl(~all) + 1;
+#if PRINT
+                cout << ((K > 0) ? "BLOCK " : "ITER  ");
+                print_vector(A);
+#endif
+            });
+            return all == full_mask;
+        };
+
+        // Active region tracking
+        ActiveRegion region(N, C);
+        bool track = (C > 0);
+
+        auto worker_fun = [&] (int t)
+        {
+#if STATS
+            unsigned long even_time = 0, even_swaps = 0;  // Statistics for even phase
+            unsigned long odd_time = 0, odd_swaps = 0;    // Statistics for odd phase
+            unsigned long barrier1_t = 0, barrier2_t = 0, update_t = 0; // Overhead statistics
+
+            unsigned long temp;
+#endif
+            pin_worker(cpus, t);
+            if(H) counters[t].open();
+
+            int E = N/2; // Number of couples in the even phase
+            int start_e = (t == 0) ? 0 : 2*( t*(E/nw) + min(E%nw, t) );
+            int end_e   = (t == nw-1) ? 2*E : start_e + 2*( (E/nw) + (t < E%nw) );
+
+            int O = (N-1)/2; // Number of couples in the odd phae
+            int start_o = 1 + ((t == 0) ? 0 : 2*( t*(O/nw) + min(O%nw, t) ));
+            int end_o   = (t == nw-1) ? 1 + 2*O : start_o + 2*( (O/nw) + (t < O%nw) );
+
+            // When tracking the active region, the worker takes the same
+            // chunks in both phases, so that each chunk has a single owner
+            int NC = region.chunks();
+            int c_lo = t*(NC/nw) + min(NC%nw, t);
+            int c_hi = c_lo + (NC/nw) + (t < NC%nw);
+
+
+            // Kernel of the next even and odd phase
+            int kern[2] = {ks.initial(), ks.initial()};
+            sort_couples_fun<T> fn;
+            auto scan_k = [&] (int s, int e) { return fn(A.data(), s, e); };
+
+            unsigned long it = 0; // Current iteration
+            unsigned long ev;     // Start of the traced event
+            int swapped_prv, nswaps;
+            bool go_on = true;
+            while(go_on) {
+                it++;
+
+                // Even phase
+                ev = trace.begin();
+#if STATS
+                {   Timer t_even(&temp);
+#endif
+                    fn = ks.fn(kern[0]);
+                    nswaps = (track) ? region.scan(c_lo, c_hi, 0, it, scan_k)
+                                     : fn(A.data(), start_e, end_e);
+                    swapped_prv = nswaps;
+#if STATS
+                }   even_time += temp;
+                    even_swaps += nswaps;
+#endif
+                trace.end(t, EV_EVEN, ev, it);
+                mark(t, 0);
+                if(klog) logs[t].record(it, 0, kern[0]);
+                if(ks.adaptive()) kern[0] = ks.pick(nswaps, (end_e-start_e)/2);
+
+                // Barrier, wait for all the workers to reach it
+                ev = trace.begin();
+#if STATS
+                {   Timer t_b1(&temp);
+#endif
+                    phase_sync(t);
+#if STATS
+                }   barrier1_t += temp;
+#endif
+                trace.end(t, EV_BARRIER1, ev, it);
+                mark(t, 1);
+
+                // Odd phase
+                ev = trace.begin();
+#if STATS
+                {   Timer t_odd(&temp);
+#endif
+                    fn = ks.fn(kern[1]);
+                    nswaps = (track) ? region.scan(c_lo, c_hi, 1, it, scan_k)
+                                     : fn(A.data(), start_o, end_o);
+                    swapped_prv |= nswaps;
+#if STATS
+                }   odd_time += temp;
+                    odd_swaps += nswaps;
+#endif
+                trace.end(t, EV_ODD, ev, it);
+                mark(t, 2);
+                if(klog) logs[t].record(it, 1, kern[1]);
+                if(ks.adaptive()) kern[1] = ks.pick(nswaps, (end_o-start_o)/2);
+
+                // Atomicly update the shared variable
+                ev = trace.begin();
+#if STATS
+                {   Timer t_update(&temp);
+#endif
+                    publish(swapped_prv != 0);
+#if STATS
+                }   update_t += temp;
+#endif
+                trace.end(t, EV_UPDATE, ev, it);
+
+                // Barrier, wait for the master thread (main) to reset the barrier
+                // (or for all the workers, with the tree barrier)
+                ev = trace.begin();
+#if STATS
+                {   Timer t_b2(&temp);
+#endif
+                    go_on = iter_sync(t, swapped_prv != 0);
+#if STATS
+                }   barrier2_t += temp;
+#endif
+                trace.end(t, EV_BARRIER2, ev, it);
+                mark(t, 3);
+            } // End of loop
+
+
+#if STATS
+            {
+                unique_lock<mutex> print_lock(print_m);
+                cout << "Worker " << t << ":" << endl
+                     << "\tAvg even phase " << ((float)even_time)/iter/1000 << " usecs"
+                     << " (" << even_swaps/iter << " swaps)" << endl
+                     << "\tAvg barrier 1  " << ((float)barrier1_t)/iter/1000 << " usecs" << endl
+                     << "\tAvg odd phase  " << ((float)odd_time)/iter/1000 << " usecs"
+                     << " (" << odd_swaps/iter << " swaps)" << endl
+                     << "\tAvg update     " << ((float)update_t)/iter/1000 << " usecs" << endl
+                     << "\tAvg barrier 2  " << ((float)barrier2_t)/iter/1000 << " usecs" << endl << endl;
+            }
+#endif
+
+            return;
+        };
+
+        // Temporal blocking: K phases between two barriers
+        // Each worker copies its block plus K elements on each side, runs the K
+        // phases on the copy and writes back only its own block: the values in
+        // the halo are wrong after a few phases, but the error moves towards the
+        // block by one element per phase, so the block itself is exact
+        auto worker_tb = [&] (int t)
+        {
+#if STATS
+            unsigned long copy_time = 0, phases_time = 0, swaps = 0; // Block statistics
+            unsigned long barrier1_t = 0, barrier2_t = 0, update_t = 0; // Overhead statistics
+            unsigned long blocks = 0;
+
+            unsigned long temp;
+#endif
+            pin_worker(cpus, t);
+            if(H) counters[t].open();
+
+            int lo, hi;
+            block(t, &lo, &hi);
+
+            // Block plus halo
+            int bl = max(0, lo-K), br = min(N, hi+K);
+            vector<T> B(br-bl);
+
+            unsigned long mask;
+            unsigned long it = 1; // First iteration of the block
+            unsigned long ev;     // Start of the traced event
+            int nswaps;
+            bool go_on = true;
+            while(go_on) {
+                // Copy the current state
+                ev = trace.begin();
+#if STATS
+                {   Timer t_copy(&temp);
+#endif
+                    copy(A.begin()+bl, A.begin()+br, B.begin());
+#if STATS
+                }   copy_time += temp;
+#endif
+                trace.end(t, EV_COPY, ev, it);
+                mark(t, 0);
+
+                // Barrier, all the workers have read their halo
+                ev = trace.begin();
+#if STATS
+                {   Timer t_b1(&temp);
+#endif
+                    phase_sync(t);
+#if STATS
+                }   barrier1_t += temp;
+#endif
+                trace.end(t, EV_BARRIER1, ev, it);
+                mark(t, 1);
+
+                // K phases on the copy, only the swaps of the couples starting
+                // in the block are counted: the others belong to the neighbours
+                ev = trace.begin();
+#if STATS
+                {   Timer t_phases(&temp);
+#endif
+                    mask = 0;
+                    for(int p=0; p<K; p++) {
+                        int par = p%2;
+                        int hs = bl + (bl%2 != par);        // First couple of the halo
+                        int os = lo + par, oe = min(N, hi + par); // Couples of the block
+
+                        sort_fn(B.data(), hs-bl, os-bl);
+                        nswaps = sort_fn(B.data(), os-bl, oe-bl);
+                        sort_fn(B.data(), oe-bl, br-bl);
+
+                        if(nswaps) mask |= 1ul << (p/2);
+#if STATS
+                        swaps += nswaps;
+#endif
+                    }
+                    copy(B.begin()+(lo-bl), B.begin()+(hi-bl), A.begin()+lo);
+#if STATS
+                }   phases_time += temp;
+                    blocks++;
+#endif
+                trace.end(t, EV_BLOCK, ev, it);
+                mark(t, 2);
+
+                // Atomicly update the shared variable
+                ev = trace.begin();
+#if STATS
+                {   Timer t_update(&temp);
+#endif
+                    publish(mask);
+#if STATS
+                }   update_t += temp;
+#endif
+                trace.end(t, EV_UPDATE, ev, it);
+
+                // Barrier, wait for the master thread (main) to reset the barrier
+                // (or for all the workers, with the tree barrier)
+                ev = trace.begin();
+#if STATS
+                {   Timer t_b2(&temp);
+#endif
+                    go_on = iter_sync(t, mask);
+#if STATS
+                }   barrier2_t += temp;
+#endif
+                trace.end(t, EV_BARRIER2, ev, it);
+                mark(t, 3);
+                it += block_iter;
+            } // End of loop
+
+
+#if STATS
+            {
+                unique_lock<mutex> print_lock(print_m);
+                cout << "Worker " << t << ":" << endl
+                     << "\tAvg copy       " << ((float)copy_time)/blocks/1000 << " usecs" << endl
+                     << "\tAvg barrier 1  " << ((float)barrier1_t)/blocks/1000 << " usecs" << endl
+                     << "\tAvg " << K << " phases  " << ((float)phases_time)/blocks/1000 << " usecs"
+                     << " (" << swaps/blocks << " swaps)" << endl
+                     << "\tAvg update     " << ((float)update_t)/blocks/1000 << " usecs" << endl
+                     << "\tAvg barrier 2  " << ((float)barrier2_t)/blocks/1000 << " usecs" << endl << endl;
+            }
+#endif
+
+            return;
+        };
+
+        // Start the workers, in decentralized mode main is worker 0
+        // and the workers terminate by themselves
+        int first = (decentral) ? 1 : 0;
+        vector<thread> workers;
+        for(int i=first; i<nw; i++) {
+            if(K > 0) workers.emplace_back(worker_tb, i);
+            else workers.emplace_back(worker_fun, i);
+        }
+
+        if(decentral) {
+            // main is pinned as worker 0 for the run only
+            cpu_set_t main_set = get_affinity();
+            if(K > 0) worker_tb(0);
+            else worker_fun(0);
+            set_affinity(main_set);
+        } else if constexpr (master_barrier<Barrier>) {
+            while(K > 0) {
+                // Wait for the end of the block
+                even_barrier.wait_all_nomod();
+#if PRINT
+                cout << "BLOCK ";
+                print_vector(A);
+#endif
+
+                // Check for termination: the first iteration without swaps is the
+                // one that would have stopped the classical version
+                unsigned long mask = swapped;
+                if(mask != full_mask) {
+                    iter += __builtin_ctzl(~mask) + 1;
+                    break;
+                }
+                iter += block_iter;
+
+                odd_barrier.reset();
+                swapped = 0;
+                even_barrier.reset();
+            }
+
+            while(K == 0) {
+                iter++;
+
+                // Wait for the end of the iteration
+                even_barrier.wait_all_nomod();
+#if PRINT
+                cout << "ITER  ";
+                print_vector(A);
+#endif
+
+                // Check for termination
+                if(!swapped) break;
+                odd_barrier.reset();
+                swapped = 0;
+                even_barrier.reset();
+            }
+
+            terminate = true; // Send termination signal
+            even_barrier.reset();
+        }
+
+        for(auto &w : workers)
+            w.join();
+
+        auto stop = high_resolution_clock::now();
+        auto total_time = duration_cast<microseconds>(stop - start).count();
+
+
+        if(opt.report) {
+            cout << "Total time with " << nw << " workers: " << ((float)total_time)/1000.0 << " msecs" << endl;
+            cout << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
+            if(klog && K == 0) print_kernel_log(ks, logs, iter);
+            if(H) {
+                if(K > 0) print_perf_counters(counters, {"copy     ", "barrier 1", "K phases ", "barrier 2"}, iter/block_iter);
+                else print_perf_counters(counters, {"even phase", "barrier 1 ", "odd phase ", "barrier 2 "}, iter);
+            }
+        }
+        if(trace.enabled()) {
+            unsigned long events = trace.dump();
+            if(opt.report)
+                cout << "Trace: " << events << " events written to " << trace_path
+                     << " (" << trace.dropped() << " dropped)" << endl;
+        }
+
+        result = iter;
+        return 0;
+    });
+
+    return (ret < 0) ? -1 : result;
+}
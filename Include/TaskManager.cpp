@@ -1,25 +1,218 @@
+#pragma once
+
 #include <iostream>
 #include <atomic>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <x86intrin.h>
+
+#include "ActiveRegion.cpp"
 
 using namespace std;
 using namespace std::chrono;
 
+/*
+ * Dynamic scheduling of the chunks of a phase
+ * Each worker owns a range of the array, the same in every phase, and takes
+ * its chunks from the front; when its range is over it steals chunks from
+ * the back of the ranges of the other workers, those on the same node
+ * first. The front and the back of a range are packed in a single word, so
+ * both ends are updated with a compare-and-swap and the workers do not
+ * share a counter.
+ * With a chunksize of 0 the size of the chunks is adaptive: it is chosen at
+ * each iteration from the run time and the swaps of the chunks of the
+ * previous one, and from the time spent retrieving them (see adapt).
+ */
 class TaskManager {
 private:
+    // Chunks of a worker, on its own cache line
+    struct alignas(64) Queue {
+        atomic<unsigned long> range; // First (low 32 bits) and last+1 (high 32 bits) chunk
+        int lo, hi;                  // Part of the array of the worker
+        int start, end;              // Interval of the current phase
+        vector<int> victims;         // Workers to steal from, in order
+
+        // Measures of the current iteration, in TSC ticks, for adapt()
+        unsigned long tasks, elems, swaps, run_t, sched_t, handed;
+    };
+
     atomic<int> current_index;
     int chunksize, size;
+    vector<Queue> queues;
+
+    bool adaptive;
+    static constexpr double overhead_ratio = 32; // Run time of a chunk over its retrieval time
+
+    static unsigned long pack(unsigned front, unsigned back) {
+        return ((unsigned long)back << 32) | front;
+    }
+
+    // Takes a chunk from the front (own range) or the back (stealing) of 'q'
+    bool take(Queue &q, bool front, int *s, int *e) {
+        unsigned long r = q.range.load(memory_order_relaxed);
+        while((unsigned)r < (r >> 32)) {
+            unsigned f = r, b = r >> 32;
+            int k = (front) ? f : b-1;
+            if(q.range.compare_exchange_weak(r, (front) ? pack(f+1, b) : pack(f, b-1))) {
+                *s = q.start + k*chunksize;
+                *e = min(q.end, *s+chunksize);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void reset_measures(Queue &q) {
+        q.tasks = q.elems = q.swaps = q.run_t = q.sched_t = 0;
+    }
+
+    /*
+     * Chooses the chunksize for the next iteration: a chunk should run
+     * 'overhead_ratio' times longer than it takes to retrieve it, which is
+     * measured along with the cost of an element (that grows with the swaps
+     * for the branchy kernels). Each worker keeps enough chunks for the
+     * stealing to balance the load, more when the swaps are concentrated in
+     * the ranges of a few workers.
+     */
+    void adapt() {
+        unsigned long tasks = 0, elems = 0, swaps = 0, max_swaps = 0, run_t = 0, sched_t = 0;
+        for(auto &q : queues) {
+            tasks += q.tasks;
+            elems += q.elems;
+            swaps += q.swaps;
+            max_swaps = max(max_swaps, q.swaps);
+            run_t += q.run_t;
+            sched_t += q.sched_t;
+            reset_measures(q);
+        }
+        if(tasks == 0 || run_t == 0) return;
+
+        long nw = queues.size();
+        long per_worker = (max_swaps*nw > 2*swaps) ? 16 : 4;
+        double cost = (double)run_t/elems, overhead = (double)sched_t/tasks;
+
+        long target = overhead_ratio * overhead / cost;
+        target = clamp(target, 2L, max(2L, size/(nw*per_worker)));
+        chunksize = max(2L, ((chunksize + target)/2) & ~1L); // Smooth the changes
+    }
+
+    // Active region tracking: the tasks are slices of the list of dirty chunks
+    ActiveRegion *region = nullptr;
+    vector<int> active;
+    int per_task = 1; // Chunks per task
 
 public:
-    TaskManager(int c, int s) : chunksize(c),size(s) {}
+    TaskManager(int c, int s) : chunksize(c),size(s) {
+        adaptive = (c <= 0);
+        set_workers(1, [&] (int, int *lo, int *hi) { *lo = 0; *hi = size; }, {0});
+    }
+
+    /*
+     * Assigns to each of the 'nw' workers its part of the array
+     *      part(t, &lo, &hi) : part of worker t, the bounds must be even
+     *                          and the parts must cover the array
+     *      node              : NUMA node of each worker
+     */
+    template<typename Part>
+    void set_workers(int nw, Part part, const vector<int> &node) {
+        queues = vector<Queue>(nw);
+        if(adaptive) chunksize = max(2, (size/(4*nw)) & ~1);
 
+        for(int t=0; t<nw; t++) {
+            part(t, &queues[t].lo, &queues[t].hi);
+            reset_measures(queues[t]);
+
+            // Neighbours first, those on the same node before the others
+            vector<int> &v = queues[t].victims;
+            for(int d=1; (int)v.size() < nw-1; d++) {
+                v.push_back((t+d) % nw);
+                if((int)v.size() < nw-1) v.push_back((t-d+nw) % nw);
+            }
+            stable_sort(v.begin(), v.end(), [&] (int a, int b) {
+                return (node[a] == node[t]) > (node[b] == node[t]);
+            });
+        }
+    }
+
+    int chunk_size() {
+        return chunksize;
+    }
+
+    // Prepare the tasks of the phase with parity 'v'
+    // Must be called while no worker is retrieving tasks
     void set_index(int v) {
-        current_index = v;
+        if(adaptive && v == 0) adapt();
+
+        for(auto &q : queues) {
+            q.start = q.lo + v;
+            q.end = (q.hi == size) ? size : q.hi + v;
+            int n = (q.start < q.end) ? (q.end - q.start + chunksize - 1)/chunksize : 0;
+            q.range = pack(0, n);
+        }
     }
 
     bool get_task(int *s, int *e) {
-        *s = current_index.fetch_add(chunksize);
-        if(*s >= size) return false;
-        *e = min(size, *s+chunksize);
+        return get_task(0, s, e);
+    }
+
+    // Retrieve a task of worker 't', stealing it if its range is over
+    bool get_task(int t, int *s, int *e) {
+        Queue &q = queues[t];
+        unsigned long t0 = (adaptive) ? __rdtsc() : 0;
+
+        bool found = take(q, true, s, e);
+        for(size_t k=0; !found && k<q.victims.size(); k++)
+            found = take(queues[q.victims[k]], false, s, e);
+
+        if(adaptive) {
+            q.handed = __rdtsc();
+            q.sched_t += q.handed - t0;
+            if(found) {
+                q.tasks++;
+                q.elems += *e - *s;
+            }
+        }
+        return found;
+    }
+
+    // Worker 't' completed its last task with 'nswaps' swaps
+    void done(int t, int nswaps) {
+        if(!adaptive) return;
+
+        Queue &q = queues[t];
+        q.run_t += __rdtsc() - q.handed;
+        q.swaps += nswaps;
+    }
+
+    // Hand out only the dirty chunks of 'r', about chunksize elements per task
+    void set_region(ActiveRegion *r) {
+        region = r;
+        per_task = max(1, chunksize/r->chunk_size());
+        active.reserve(r->chunks());
+    }
+
+    // Prepare the list of the chunks to be scanned in phase 'par' of
+    // iteration 'iter', the clean ones are marked as unchanged
+    // Must be called while no worker is retrieving tasks
+    void set_phase(int par, unsigned long iter) {
+        active.clear();
+        for(int c=0; c<region->chunks(); c++) {
+            if(region->dirty(c, par, iter)) active.push_back(c);
+            else region->update(c, par, 0);
+        }
+        current_index = 0;
+    }
+
+    // Retrieve the positions [s, e) of the list, see chunk()
+    bool get_chunks(int *s, int *e) {
+        *s = current_index.fetch_add(per_task);
+        if(*s >= (int)active.size()) return false;
+        *e = min((int)active.size(), *s+per_task);
         return true;
     }
+
+    int chunk(int k) {
+        return active[k];
+    }
 };
\ No newline at end of file
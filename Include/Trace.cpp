@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <x86intrin.h>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Per-thread event tracing
+ * Each thread records its events, stamped with the TSC, in its own ring
+ * buffer: a single writer per buffer, so no locks nor atomics are needed,
+ * and when a buffer is full the oldest events are overwritten. At the end
+ * the buffers are written in the Chrome trace format (JSON), to be opened
+ * with chrome://tracing or Perfetto. When the tracer is disabled begin()
+ * does not read the TSC and end() returns at the first test.
+ *
+ *      unsigned long ev = trace.begin();
+ *      ...
+ *      trace.end(t, EV_EVEN, ev, iter);
+ */
+
+enum TraceKind : unsigned {
+    EV_EVEN, EV_ODD, EV_BARRIER1, EV_BARRIER2, EV_UPDATE, EV_FETCH, EV_TASK, EV_COPY, EV_BLOCK
+};
+
+class Tracer {
+private:
+    static constexpr const char *names[] = {
+        "even phase", "odd phase", "barrier 1", "barrier 2", "update", "task fetch", "task", "copy", "phases"
+    };
+
+    struct Event {
+        unsigned long begin, end;
+        unsigned long arg; // Iteration, or first element of the task
+        unsigned kind;
+    };
+
+    // Buffer of a thread, on its own cache lines
+    struct alignas(64) Ring {
+        vector<Event> events;
+        unsigned long head = 0;
+    };
+
+    vector<Ring> rings;
+    unsigned long mask;
+    const char *path;
+    bool on;
+
+    // Reference for the conversion of the TSC to microseconds
+    unsigned long tsc0;
+    steady_clock::time_point t0;
+
+public:
+    /*
+     * Tracer for 'nt' threads, disabled when 'path' is null, each thread
+     * keeps the last 'capacity' events (rounded to a power of 2)
+     */
+    Tracer(int nt, const char *path, size_t capacity = 1 << 16) : path(path), on(path != nullptr) {
+        size_t cap = 1;
+        while(cap < capacity) cap <<= 1;
+        mask = cap-1;
+
+        if(on) {
+            rings = vector<Ring>(nt);
+            for(auto &r : rings) r.events.resize(cap);
+        }
+        t0 = steady_clock::now();
+        tsc0 = __rdtsc();
+    }
+
+    bool enabled() const {
+        return on;
+    }
+
+    unsigned long begin() const {
+        return (on) ? __rdtsc() : 0;
+    }
+
+    void end(int t, TraceKind kind, unsigned long begin, unsigned long arg = 0) {
+        if(!on) return;
+        Ring &r = rings[t];
+        r.events[r.head & mask] = Event{begin, __rdtsc(), arg, kind};
+        r.head++;
+    }
+
+    /*
+     * Writes the events of all the threads, to be called when they are
+     * over; returns the number of events written
+     */
+    unsigned long dump() {
+        if(!on) return 0;
+
+        double us = duration_cast<nanoseconds>(steady_clock::now() - t0).count()/1000.0;
+        double ticks = (__rdtsc() - tsc0)/max(us, 1.0); // TSC ticks per microsecond
+
+        ofstream out(path);
+        out.precision(3);
+        out << fixed << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << endl;
+
+        unsigned long count = 0;
+        for(size_t t=0; t<rings.size(); t++) {
+            Ring &r = rings[t];
+            out << ((t == 0) ? "" : ",\n")
+                << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << t
+                << ", \"args\": {\"name\": \"Worker " << t << "\"}}";
+
+            unsigned long first = (r.head > mask) ? r.head - mask - 1 : 0;
+            for(unsigned long i=first; i<r.head; i++, count++) {
+                Event &e = r.events[i & mask];
+                out << ",\n{\"name\": \"" << names[e.kind] << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << t
+                    << ", \"ts\": " << (e.begin - tsc0)/ticks << ", \"dur\": " << (e.end - e.begin)/ticks
+                    << ", \"args\": {\"" << ((e.kind == EV_TASK || e.kind == EV_FETCH) ? "start" : "iter")
+                    << "\": " << e.arg << "}}";
+            }
+        }
+        out << endl << "]}" << endl;
+        return count;
+    }
+
+    // Events lost because a buffer was full
+    unsigned long dropped() const {
+        unsigned long n = 0;
+        for(auto &r : rings)
+            if(r.head > mask) n += r.head - mask - 1;
+        return n;
+    }
+};
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <csignal>
+#include <new>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Communication between the ranks (processes) of the distributed version
+ * A rank only talks to its neighbours (rank-1 and rank+1), with blocking
+ * point-to-point messages, plus a global OR reduction for the termination.
+ * The implementations override do_send, do_recv and, if they have a faster
+ * one than the default (along the chain of the ranks), allreduce_or:
+ *      ShmTransport  : ring buffers in a shared memory segment, one for
+ *                      each direction of each couple of neighbours, and a
+ *                      shared barrier for the reduction
+ *      UnixTransport : a Unix domain socket for each couple of neighbours
+ * The bytes sent and received and the time spent in the calls are counted
+ * for each rank: waiting for a message or for the reduction ('wait') and
+ * sending ('send', blocking only when the peer is not receiving).
+ * Both are set up before the ranks are started, see spawn_ranks.
+ */
+class Transport {
+protected:
+    int r, np;
+
+    virtual void do_send(int peer, const void *buf, size_t n) = 0;
+    virtual void do_recv(int peer, void *buf, size_t n) = 0;
+
+public:
+    unsigned long bytes_sent = 0, bytes_received = 0;
+    unsigned long send_time = 0, wait_time = 0; // nsecs
+
+    Transport(int rank, int size) : r(rank), np(size) {}
+    virtual ~Transport() = default;
+
+    int rank() const {
+        return r;
+    }
+
+    int size() const {
+        return np;
+    }
+
+    // Restarts the counts, e.g. after the start-up synchronization
+    void reset_counters() {
+        bytes_sent = bytes_received = 0;
+        send_time = wait_time = 0;
+    }
+
+    // Sends 'n' bytes to the neighbour 'peer'
+    void send(int peer, const void *buf, size_t n) {
+        auto start = steady_clock::now();
+        do_send(peer, buf, n);
+        send_time += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        bytes_sent += n;
+    }
+
+    // Receives 'n' bytes from the neighbour 'peer'
+    void recv(int peer, void *buf, size_t n) {
+        auto start = steady_clock::now();
+        do_recv(peer, buf, n);
+        wait_time += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        bytes_received += n;
+    }
+
+    /*
+     * OR of 'flag' over all the ranks: reduced from the last rank to the
+     * first one, then sent back
+     */
+    virtual unsigned long allreduce_or(unsigned long flag) {
+        unsigned long v;
+        if(r < np-1) {
+            recv(r+1, &v, sizeof(v));
+            flag |= v;
+        }
+        if(r > 0) {
+            send(r-1, &flag, sizeof(flag));
+            recv(r-1, &flag, sizeof(flag));
+        }
+        if(r < np-1) send(r+1, &flag, sizeof(flag));
+        return flag;
+    }
+};
+
+
+/*
+ * Futex on a word shared between processes (not private to this one)
+ * The waiters spin with a pause for a while, then sleep
+ */
+struct SharedWord {
+    atomic<uint32_t> events{0};
+    atomic<uint32_t> sleepers{0};
+
+    static const int spin = 1 << 12;
+
+    template<typename Cond>
+    void wait_until(Cond cond) {
+        for(int i=0; i<spin; i++) {
+            if(cond()) return;
+            _mm_pause();
+        }
+        while(!cond()) {
+            sleepers++;
+            uint32_t e = events;
+            if(!cond())
+                syscall(SYS_futex, (uint32_t *)&events, FUTEX_WAIT, e, nullptr, nullptr, 0);
+            sleepers--;
+        }
+    }
+
+    void notify() {
+        events++;
+        if(sleepers > 0)
+            syscall(SYS_futex, (uint32_t *)&events, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+};
+
+class ShmTransport : public Transport {
+public:
+    // One direction of a couple of neighbours, followed by 'capacity' bytes
+    struct Channel {
+        alignas(64) atomic<uint64_t> head; // Bytes written
+        alignas(64) atomic<uint64_t> tail; // Bytes read
+        alignas(64) SharedWord word;
+
+        char *data() {
+            return (char *)(this + 1);
+        }
+    };
+
+    // Barrier of the reduction, as HybridBarrier::wait
+    struct Reduction {
+        alignas(64) atomic<int> count;
+        alignas(64) atomic<uint32_t> generation;
+        atomic<unsigned long> flags_or;
+        unsigned long result;
+        SharedWord word;
+    };
+
+    /*
+     * Shared segment of 'np' ranks, mapped before the processes are forked,
+     * with channels of 'capacity' bytes (at least 1)
+     */
+    static void *create(int np, size_t capacity) {
+        size_t bytes = segment_size(np, capacity);
+        void *seg = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(seg == MAP_FAILED) return nullptr;
+
+        Reduction *red = new(seg) Reduction();
+        red->count = np;
+        red->generation = 0;
+        red->flags_or = 0;
+        for(int c=0; c<2*(np-1); c++) {
+            Channel *ch = new(channel_at(seg, c, capacity)) Channel();
+            ch->head = 0;
+            ch->tail = 0;
+        }
+        return seg;
+    }
+
+    static size_t segment_size(int np, size_t capacity) {
+        return channel_offset(2*max(np-1, 0), capacity);
+    }
+
+    ShmTransport(int rank, int size, void *seg, size_t capacity)
+        : Transport(rank, size), seg(seg), capacity(capacity) {}
+
+    unsigned long allreduce_or(unsigned long flag) override {
+        auto start = steady_clock::now();
+        Reduction *red = (Reduction *)seg;
+        uint32_t g = red->generation;
+        if(flag) red->flags_or |= flag;
+
+        unsigned long result;
+        if(--red->count > 0) {
+            red->word.wait_until([&] { return red->generation != g; });
+            result = red->result;
+        } else {
+            result = red->result = red->flags_or.exchange(0);
+            red->count = np;
+            red->generation++;
+            red->word.notify();
+        }
+        wait_time += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        return result;
+    }
+
+protected:
+    void do_send(int peer, const void *buf, size_t n) override {
+        Channel *ch = channel(r, peer);
+        const char *p = (const char *)buf;
+        while(n > 0) {
+            ch->word.wait_until([&] { return ch->head - ch->tail < capacity; });
+            uint64_t h = ch->head;
+            size_t k = min({n, (size_t)(capacity - (h - ch->tail)), (size_t)(capacity - h%capacity)});
+            memcpy(ch->data() + h%capacity, p, k);
+            ch->head.store(h + k, memory_order_release);
+            ch->word.notify();
+            p += k;
+            n -= k;
+        }
+    }
+
+    void do_recv(int peer, void *buf, size_t n) override {
+        Channel *ch = channel(peer, r);
+        char *p = (char *)buf;
+        while(n > 0) {
+            ch->word.wait_until([&] { return ch->head.load(memory_order_acquire) > ch->tail; });
+            uint64_t t = ch->tail;
+            size_t k = min({n, (size_t)(ch->head - t), (size_t)(capacity - t%capacity)});
+            memcpy(p, ch->data() + t%capacity, k);
+            ch->tail.store(t + k, memory_order_release);
+            ch->word.notify();
+            p += k;
+            n -= k;
+        }
+    }
+
+private:
+    void *seg;
+    size_t capacity;
+
+    static size_t channel_offset(int c, size_t capacity) {
+        size_t stride = (sizeof(Channel) + capacity + 63) & ~(size_t)63;
+        return ((sizeof(Reduction) + 63) & ~(size_t)63) + c*stride;
+    }
+
+    static void *channel_at(void *seg, int c, size_t capacity) {
+        return (char *)seg + channel_offset(c, capacity);
+    }
+
+    // Channel from rank 'from' to its neighbour 'to'
+    Channel *channel(int from, int to) {
+        int c = 2*min(from, to) + (from > to);
+        return (Channel *)channel_at(seg, c, capacity);
+    }
+};
+
+
+class UnixTransport : public Transport {
+public:
+    /*
+     * Sockets of 'np' ranks, created before the processes are forked:
+     * fds[2i] and fds[2i+1] are the ends of ranks i and i+1
+     */
+    static bool create(int np, vector<int> &fds) {
+        fds.assign(2*max(np-1, 0), -1);
+        for(int i=0; i<np-1; i++)
+            if(socketpair(AF_UNIX, SOCK_STREAM, 0, &fds[2*i]) < 0) return false;
+        return true;
+    }
+
+    // Keeps the ends of 'rank', closes the others
+    UnixTransport(int rank, int size, const vector<int> &fds) : Transport(rank, size) {
+        for(int i=0; i<(int)fds.size(); i++) {
+            if(i == 2*rank - 1)    left = fds[i];
+            else if(i == 2*rank)   right = fds[i];
+            else                   close(fds[i]);
+        }
+    }
+
+    ~UnixTransport() {
+        if(left >= 0) close(left);
+        if(right >= 0) close(right);
+    }
+
+protected:
+    void do_send(int peer, const void *buf, size_t n) override {
+        int fd = (peer < r) ? left : right;
+        const char *p = (const char *)buf;
+        while(n > 0) {
+            ssize_t k = write(fd, p, n);
+            if(k <= 0) {
+                if(k < 0 && errno == EINTR) continue;
+                cout << "Rank " << r << ": send to " << peer << " failed" << endl;
+                _exit(1);
+            }
+            p += k;
+            n -= k;
+        }
+    }
+
+    void do_recv(int peer, void *buf, size_t n) override {
+        int fd = (peer < r) ? left : right;
+        char *p = (char *)buf;
+        while(n > 0) {
+            ssize_t k = read(fd, p, n);
+            if(k <= 0) {
+                if(k < 0 && errno == EINTR) continue;
+                cout << "Rank " << r << ": receive from " << peer << " failed" << endl;
+                _exit(1);
+            }
+            p += k;
+            n -= k;
+        }
+    }
+
+private:
+    int left = -1, right = -1;
+};
+
+
+/*
+ * Starts 'np' local ranks as processes, connected by the transport 'kind'
+ * (shm or unix), each running 'body(transport)'. The standard output is
+ * flushed before forking. Returns 0 when every rank returned 0, -1
+ * otherwise (or if the transport is unknown or cannot be set up); when a
+ * rank fails the others are killed
+ */
+template<typename F>
+int spawn_ranks(const char *kind, int np, F body, size_t capacity = 1 << 20) {
+    void *seg = nullptr;
+    vector<int> fds;
+    if(strcmp(kind, "shm") == 0) {
+        if(capacity == 0) {
+            cout << "The capacity of a channel must be positive" << endl;
+            return -1;
+        }
+        seg = ShmTransport::create(np, capacity);
+        if(!seg) {
+            cout << "Cannot map the shared segment" << endl;
+            return -1;
+        }
+    } else if(strcmp(kind, "unix") == 0) {
+        if(!UnixTransport::create(np, fds)) {
+            cout << "Cannot create the sockets" << endl;
+            return -1;
+        }
+    } else {
+        cout << "Unknown transport " << kind << endl;
+        return -1;
+    }
+
+    cout.flush();
+    vector<pid_t> pids;
+    for(int r=0; r<np; r++) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            unique_ptr<Transport> tr;
+            if(seg) tr.reset(new ShmTransport(r, np, seg, capacity));
+            else    tr.reset(new UnixTransport(r, np, fds));
+            int ret = body(*tr);
+            cout.flush();
+            _exit(ret == 0 ? 0 : 1);
+        }
+        if(pid < 0) {
+            cout << "Cannot start rank " << r << endl;
+            for(pid_t p : pids) kill(p, SIGKILL);
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    for(int fd : fds) close(fd);
+    int ret = ((int)pids.size() == np) ? 0 : -1;
+    // A rank that failed would leave its neighbours waiting: stop the others
+    for(size_t left = pids.size(); left > 0; left--) {
+        int status;
+        pid_t p = waitpid(-1, &status, 0);
+        if(p < 0) break;
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            if(ret == 0)
+                for(pid_t q : pids) if(q != p) kill(q, SIGKILL);
+            ret = -1;
+        }
+    }
+    if(seg) munmap(seg, ShmTransport::segment_size(np, capacity));
+    return ret;
+}
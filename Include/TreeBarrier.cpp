@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <immintrin.h>
+
+using namespace std;
+
+/*
+ * Combining tree barrier, that also computes the OR of the flags of the
+ * threads (e.g. the swaps of each worker), so that the termination is known
+ * at the barrier without a shared atomic variable.
+ * The threads are the nodes of a tree with 'fanin' children per node (thread
+ * 0 is the root): each thread waits for its children, combines their flags
+ * with its own and passes them to its parent; the root runs the completion
+ * function, then the result is propagated down the tree. Every slot is
+ * written by one thread and read by at most 'fanin' ones, so both arrival
+ * and release take O(log nw) steps without a contended cache line.
+ * Slots are tagged with the epoch (number of barriers passed), so the
+ * barrier can be reused without resetting it.
+ */
+class TreeBarrier {
+private:
+    struct alignas(64) Slot {
+        atomic<unsigned long> epoch;
+        unsigned long value;
+    };
+
+    int nw, fanin;
+    vector<Slot> up;    // Flags of the subtree, for the parent
+    vector<Slot> down;  // Result, for the children
+    vector<Slot> local; // Epoch of each thread (only the epoch field is used)
+
+    static const int spin = 1 << 12; // Pauses before yielding the core
+
+    // Wait until the slot reaches the epoch 'e'
+    static void wait_epoch(Slot &s, unsigned long e) {
+        int spent = 0;
+        while(s.epoch.load(memory_order_acquire) != e) {
+            if(spent++ < spin) _mm_pause();
+            else this_thread::yield();
+        }
+    }
+
+public:
+    TreeBarrier(int n, int f = 4) : nw(n), fanin(f), up(n), down(n), local(n) {
+        for(int t=0; t<nw; t++) {
+            up[t].epoch = 0;
+            down[t].epoch = 0;
+            local[t].epoch = 0;
+        }
+    }
+
+    /*
+     * Barrier wait for thread 't', returns the OR of the flags of all the
+     * threads. 'complete(all)' is run by a single thread when everybody
+     * arrived, before anyone leaves the barrier.
+     */
+    template<typename F>
+    unsigned long wait(int t, unsigned long flags, F complete) {
+        unsigned long e = local[t].epoch.load(memory_order_relaxed) + 1;
+        local[t].epoch.store(e, memory_order_relaxed);
+
+        // Arrival: combine the flags of the children
+        for(int c=fanin*t+1; c<=fanin*t+fanin && c<nw; c++) {
+            wait_epoch(up[c], e);
+            flags |= up[c].value;
+        }
+
+        if(t == 0) {
+            complete(flags);
+        } else {
+            up[t].value = flags;
+            up[t].epoch.store(e, memory_order_release);
+
+            // Release: wait for the parent
+            Slot &p = down[(t-1)/fanin];
+            wait_epoch(p, e);
+            flags = p.value;
+        }
+
+        down[t].value = flags;
+        down[t].epoch.store(e, memory_order_release);
+        return flags;
+    }
+
+    unsigned long wait(int t, unsigned long flags) {
+        return wait(t, flags, [] (unsigned long) {});
+    }
+};
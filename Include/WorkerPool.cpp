@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "HybridBarrier.cpp"
+
+using namespace std;
+
+/*
+ * Team of threads created once and reused for many jobs
+ * The calling thread is worker 0, the other 'nw-1' threads wait for the
+ * next job at a HybridBarrier, so between jobs they spin for a while and
+ * then sleep on a futex, instead of burning their cores.
+ * A job is run by one thread at a time (run is not reentrant).
+ */
+class WorkerPool {
+private:
+    int nw;
+    vector<thread> threads;
+    HybridBarrier start_barrier, done_barrier;
+
+    // Current job, type-erased without allocations
+    void (*invoke)(void *, int) = nullptr;
+    void *job = nullptr;
+    int job_nw = 0;
+    bool stop = false;
+
+    void worker_loop(int t) {
+        while(true) {
+            start_barrier.wait(t, 0);
+            if(stop) return;
+            if(t < job_nw) invoke(job, t);
+            done_barrier.wait(t, 0);
+        }
+    }
+
+public:
+    WorkerPool(int n, int spin = HybridBarrier::default_spin)
+        : nw(max(1, n)), start_barrier(nw, spin), done_barrier(nw, spin) {
+        for(int t=1; t<nw; t++)
+            threads.emplace_back(&WorkerPool::worker_loop, this, t);
+    }
+
+    ~WorkerPool() {
+        stop = true;
+        start_barrier.wait(0, 0);
+        for(auto &th : threads) th.join();
+    }
+
+    int max_workers() {
+        return nw;
+    }
+
+    /*
+     * Runs 'worker(t)' for t in [0, n) on the threads of the pool, n must
+     * not exceed max_workers(); returns when all of them are done
+     */
+    template<typename F>
+    void run(int n, F worker) {
+        invoke = [] (void *f, int t) { (*(F *)f)(t); };
+        job = &worker;
+        job_nw = n;
+
+        start_barrier.wait(0, 0);
+        worker(0);
+        done_barrier.wait(0, 0);
+    }
+};
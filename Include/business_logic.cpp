@@ -1,16 +1,86 @@
+#pragma once
+
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <immintrin.h>
 
 using namespace std;
 
+/*
+ * The kernels are templated on the element type 'T' and on the ordering
+ * 'Compare': a couple is swapped when Compare()(second, first), so with the
+ * default less<T> it is swapped when first > second.
+ * Comparators are default constructed, so they must be stateless.
+ */
+
+/*
+ * Comparator on a key extracted from the elements, e.g. key_less<&Record::key>
+ * 'Key' is a pointer to a data member, or to a function taking an element
+ */
+template<auto Key>
+struct key_less {
+    template<typename T>
+    bool operator()(const T &a, const T &b) const {
+        return invoke(Key, a) < invoke(Key, b);
+    }
+};
+
+/*
+ * Part of the array of worker 't', the same partition of the even phase
+ * used by the static engines (the last worker takes the odd element)
+ */
+inline void even_partition(int n, int nw, int t, int *lo, int *hi) {
+    int E = n/2;
+    *lo = (t == 0) ? 0 : 2*( t*(E/nw) + min(E%nw, t) );
+    *hi = (t == nw-1) ? n : *lo + 2*( (E/nw) + (t < E%nw) );
+}
+
+/*
+ * Merge-split of the sorted block [lo, hi) of 'A' with its sorted neighbour
+ * [nlo, nhi), used by the block versions: writes to 'B' the part of the
+ * merge that belongs to [lo, hi), the smallest elements if it is the left
+ * block, the largest ones otherwise. On equal elements the ones of the left
+ * block come first on both sides, so that the two parts are a partition of
+ * the two blocks.
+ * Returns false if the blocks are already in order
+ */
+template<typename T, typename Compare>
+bool merge_split_blocks(const T *A, int lo, int hi, int nlo, int nhi, T *B, Compare comp) {
+    if(lo == hi || nlo == nhi) return false;
+
+    if(nlo > lo) {
+        // Left block: keep the smallest elements, merging from the front
+        if(!comp(A[nlo], A[hi-1])) return false;
+
+        int i = lo, j = nlo;
+        for(int k=0; k<hi-lo; k++)
+            B[k] = (j == nhi || !comp(A[j], A[i])) ? A[i++] : A[j++];
+    } else {
+        // Right block: keep the largest elements, merging from the back
+        if(!comp(A[lo], A[nhi-1])) return false;
+
+        int i = hi-1, j = nhi-1;
+        for(int k=hi-lo-1; k>=0; k--)
+            B[k] = (j < nlo || !comp(A[i], A[j])) ? A[i--] : A[j--];
+    }
+    return true;
+}
+
+
 /*
  * Classical sequential version
- * 'A' is the vector to be sorted
+ * 'A' is the array to be sorted
  * 'start' and 'end' are the extremes of the interval to work on
  */
-inline int sort_couples(vector<int> &A, int start, int end) {
+template<typename T, typename Compare = less<T>>
+inline int sort_couples(T *A, int start, int end) {
+    Compare comp;
     int swapped = 0;
     for(int i=start; i<end-1; i+=2) {
-        if(A[i] > A[i+1]) {
+        if(comp(A[i+1], A[i])) {
             swap(A[i], A[i+1]);
             swapped++;
         }
@@ -21,26 +91,388 @@ inline int sort_couples(vector<int> &A, int start, int end) {
 
 
 /*
- * Trying to exploit vectorization
- * Does not seem to work properly
+ * Branchless version, conditional assignments instead of the swap
+ * Used for the arithmetic types without a vectorized version, and to
+ * complete the tail of the vectorized versions
  */
-inline int sort_couples_vec(vector<int> &A, int start, int end) {
+template<typename T, typename Compare = less<T>>
+inline int sort_couples_branchless(T *A, int start, int end) {
+    Compare comp;
     int swapped = 0;
 
-#pragma GCC ivdep
-    for(int i=start; i<end; i+=2) {
+    for(int i=start; i<end-1; i+=2) {
 
-        int first = A[i];
-        int second = A[i+1];
-        int toSwap = first > second;
+        T first = A[i];
+        T second = A[i+1];
+        int toSwap = comp(second, first);
 
-        // Conditional assignments, can be vectorized
         A[i] = (toSwap) ? second : first;
         A[i+1] = (toSwap) ? first : second;
 
-        // Reduce operation can be vectorized
         swapped += toSwap;
     }
 
     return swapped;
-}
\ No newline at end of file
+}
+
+
+/*
+ * Vectorized versions
+ * Each register holds a sequence of couples: the elements of each couple
+ * are exchanged with a shuffle, so that min/max can be applied lane-wise and
+ * the results are blended back (min in the even lanes, max in the odd ones).
+ * The swaps are counted with a popcount of the comparison mask restricted to
+ * the first element of each couple.
+ * Compiled with the 'target' attribute, so they must only be called on a CPU
+ * supporting the instruction set (see select_sort_couples)
+ */
+__attribute__((target("sse4.1,popcnt")))
+inline int sort_couples_sse(int *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+4 <= end; i+=4) { // 2 couples per iteration
+        __m128i v  = _mm_loadu_si128((__m128i *)(A+i));
+        __m128i sw = _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1));
+
+        __m128i mn = _mm_min_epi32(v, sw);
+        __m128i mx = _mm_max_epi32(v, sw);
+        _mm_storeu_si128((__m128i *)(A+i), _mm_blend_epi16(mn, mx, 0xCC));
+
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, sw)));
+        swapped += __builtin_popcount(mask & 0x5);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+__attribute__((target("avx2,popcnt")))
+inline int sort_couples_avx2(int *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+8 <= end; i+=8) { // 4 couples per iteration
+        __m256i v  = _mm256_loadu_si256((__m256i *)(A+i));
+        __m256i sw = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1));
+
+        __m256i mn = _mm256_min_epi32(v, sw);
+        __m256i mx = _mm256_max_epi32(v, sw);
+        _mm256_storeu_si256((__m256i *)(A+i), _mm256_blend_epi32(mn, mx, 0xAA));
+
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, sw)));
+        swapped += __builtin_popcount(mask & 0x55);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+__attribute__((target("avx512f,popcnt")))
+inline int sort_couples_avx512(int *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+16 <= end; i+=16) { // 8 couples per iteration
+        __m512i v  = _mm512_loadu_si512((void *)(A+i));
+        __m512i sw = _mm512_mask_shuffle_epi32(v, 0xFFFF, v, (_MM_PERM_ENUM)_MM_SHUFFLE(2,3,0,1));
+
+        // Masked min/max do the blend
+        __m512i r = _mm512_mask_min_epi32(v, 0x5555, v, sw);
+        r = _mm512_mask_max_epi32(r, 0xAAAA, v, sw);
+        _mm512_storeu_si512((void *)(A+i), r);
+
+        __mmask16 mask = _mm512_cmpgt_epi32_mask(v, sw);
+        swapped += __builtin_popcount(mask & 0x5555);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+
+/*
+ * For int64_t, float and double the elements are moved rather than
+ * recomputed: the comparison mask of the first element of each couple is
+ * copied to the second one, and the exchanged register is blended where the
+ * mask is set. For floating point this keeps NaNs and signed zeros exactly
+ * as the scalar version.
+ */
+__attribute__((target("avx2,popcnt")))
+inline int sort_couples_avx2(int64_t *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+4 <= end; i+=4) { // 2 couples per iteration
+        __m256i v  = _mm256_loadu_si256((__m256i *)(A+i));
+        __m256i sw = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2));
+
+        __m256i gt = _mm256_cmpgt_epi64(v, sw);
+        __m256i m  = _mm256_blend_epi32(gt, _mm256_shuffle_epi32(gt, _MM_SHUFFLE(1,0,3,2)), 0xCC);
+        _mm256_storeu_si256((__m256i *)(A+i), _mm256_blendv_epi8(v, sw, m));
+
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(gt));
+        swapped += __builtin_popcount(mask & 0x5);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+__attribute__((target("avx512f,popcnt")))
+inline int sort_couples_avx512(int64_t *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+8 <= end; i+=8) { // 4 couples per iteration
+        __m512i v  = _mm512_loadu_si512((void *)(A+i));
+        __m512i sw = _mm512_mask_shuffle_epi32(v, 0xFFFF, v, (_MM_PERM_ENUM)_MM_SHUFFLE(1,0,3,2));
+
+        __mmask8 gt = _mm512_cmpgt_epi64_mask(v, sw) & 0x55;
+        _mm512_storeu_si512((void *)(A+i), _mm512_mask_blend_epi64(gt | (gt << 1), v, sw));
+
+        swapped += __builtin_popcount(gt);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+__attribute__((target("avx2,popcnt")))
+inline int sort_couples_avx2(float *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+8 <= end; i+=8) { // 4 couples per iteration
+        __m256 v  = _mm256_loadu_ps(A+i);
+        __m256 sw = _mm256_permute_ps(v, _MM_SHUFFLE(2,3,0,1));
+
+        __m256 gt = _mm256_cmp_ps(v, sw, _CMP_GT_OQ);
+        __m256 m  = _mm256_blend_ps(gt, _mm256_permute_ps(gt, _MM_SHUFFLE(2,3,0,1)), 0xAA);
+        _mm256_storeu_ps(A+i, _mm256_blendv_ps(v, sw, m));
+
+        int mask = _mm256_movemask_ps(gt);
+        swapped += __builtin_popcount(mask & 0x55);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+__attribute__((target("avx512f,popcnt")))
+inline int sort_couples_avx512(float *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+16 <= end; i+=16) { // 8 couples per iteration
+        __m512 v  = _mm512_loadu_ps(A+i);
+        __m512 sw = _mm512_castsi512_ps(_mm512_mask_shuffle_epi32(_mm512_castps_si512(v), 0xFFFF,
+                        _mm512_castps_si512(v), (_MM_PERM_ENUM)_MM_SHUFFLE(2,3,0,1)));
+
+        __mmask16 gt = _mm512_cmp_ps_mask(v, sw, _CMP_GT_OQ) & 0x5555;
+        _mm512_storeu_ps(A+i, _mm512_mask_blend_ps(gt | (gt << 1), v, sw));
+
+        swapped += __builtin_popcount(gt);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+
+__attribute__((target("avx2,popcnt")))
+inline int sort_couples_avx2(double *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+4 <= end; i+=4) { // 2 couples per iteration
+        __m256d v  = _mm256_loadu_pd(A+i);
+        __m256d sw = _mm256_permute_pd(v, 0x5);
+
+        __m256d gt = _mm256_cmp_pd(v, sw, _CMP_GT_OQ);
+        __m256d m  = _mm256_blend_pd(gt, _mm256_permute_pd(gt, 0x5), 0xA);
+        _mm256_storeu_pd(A+i, _mm256_blendv_pd(v, sw, m));
+
+        int mask = _mm256_movemask_pd(gt);
+        swapped += __builtin_popcount(mask & 0x5);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+__attribute__((target("avx512f,popcnt")))
+inline int sort_couples_avx512(double *A, int start, int end) {
+    int swapped = 0;
+
+    int i = start;
+    for(; i+8 <= end; i+=8) { // 4 couples per iteration
+        __m512d v  = _mm512_loadu_pd(A+i);
+        __m512d sw = _mm512_castsi512_pd(_mm512_mask_shuffle_epi32(_mm512_castpd_si512(v), 0xFFFF,
+                         _mm512_castpd_si512(v), (_MM_PERM_ENUM)_MM_SHUFFLE(1,0,3,2)));
+
+        __mmask8 gt = _mm512_cmp_pd_mask(v, sw, _CMP_GT_OQ) & 0x55;
+        _mm512_storeu_pd(A+i, _mm512_mask_blend_pd(gt | (gt << 1), v, sw));
+
+        swapped += __builtin_popcount(gt);
+    }
+
+    return swapped + sort_couples_branchless(A, i, end);
+}
+
+template<typename T>
+using sort_couples_fun = int (*)(T *, int, int);
+
+// Types with a vectorized version
+template<typename T, typename Compare>
+constexpr bool has_simd_couples = is_same_v<Compare, less<T>> &&
+    (is_same_v<T, int> || is_same_v<T, int64_t> || is_same_v<T, float> || is_same_v<T, double>);
+
+/*
+ * Picks the version of sort_couples for the element type and the ordering:
+ * the widest vectorized one supported by the running CPU for the default
+ * ordering of int, int64_t, float and double, the branchless one for the other
+ * arithmetic types, the classical one otherwise (e.g. records)
+ * All the versions give the same result and the same number of swaps
+ */
+template<typename T, typename Compare = less<T>>
+inline sort_couples_fun<T> select_sort_couples() {
+    if constexpr (has_simd_couples<T, Compare>) {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f")) return sort_couples_avx512;
+        if(__builtin_cpu_supports("avx2"))    return sort_couples_avx2;
+        if constexpr (is_same_v<T, int>)
+            if(__builtin_cpu_supports("sse4.1")) return sort_couples_sse;
+        return sort_couples_branchless<T>;
+    } else if constexpr (is_arithmetic_v<T> && is_same_v<Compare, less<T>>)
+        return sort_couples_branchless<T>;
+    else
+        return sort_couples<T, Compare>;
+}
+
+/*
+ * Name of the selected version, for the statistics
+ */
+template<typename T, typename Compare = less<T>>
+inline const char *sort_couples_name(sort_couples_fun<T> f) {
+    if constexpr (has_simd_couples<T, Compare>) {
+        if(f == (sort_couples_fun<T>)sort_couples_avx512) return "avx512";
+        if(f == (sort_couples_fun<T>)sort_couples_avx2)   return "avx2";
+    }
+    if constexpr (is_same_v<T, int>)
+        if(f == sort_couples_sse) return "sse4.1";
+    if(f == sort_couples_branchless<T, Compare>) return "branchless";
+    return "scalar";
+}
+
+
+/*
+ * Sorting network for small arrays (at most SMALL_SORT elements)
+ * Odd-even transposition needs about n/2 iterations whatever the initial
+ * order, so very small arrays (e.g. the short segments, or the blocks of
+ * the block version with many workers) are sorted in place with a sorting
+ * network instead, for int with AVX2: the array is loaded in 8 registers
+ * of 8 elements (the missing ones are INT_MAX), the columns are sorted by
+ * an 8-input network of min/max, the 8x8 matrix is transposed, so that each
+ * register holds a sorted run, and the runs are merged two by two with
+ * bitonic merges, all in registers. For the other types the vectorized
+ * odd-even transposition is as fast as an insertion sort, so there is no
+ * scalar version.
+ * Pre-sorting tiles of a larger array this way does not reduce the number
+ * of iterations, the elements still have to cross the whole array.
+ */
+constexpr int SMALL_SORT = 64;
+
+__attribute__((target("avx2"), always_inline))
+inline void compare_exchange(__m256i &a, __m256i &b) {
+    __m256i mn = _mm256_min_epi32(a, b);
+    b = _mm256_max_epi32(a, b);
+    a = mn;
+}
+
+// Sorts a bitonic register
+__attribute__((target("avx2"), always_inline))
+inline __m256i bitonic_clean8(__m256i v) {
+    __m256i p = _mm256_permute2x128_si256(v, v, 1);
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xF0);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xCC);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1));
+    return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xAA);
+}
+
+// Sorts the bitonic sequence of the K registers 'v'
+template<int K>
+__attribute__((target("avx2"), always_inline))
+inline void bitonic_clean(__m256i *v) {
+    for(int d=K/2; d>=1; d/=2)
+        for(int i=0; i<K; i++)
+            if(!(i & d)) compare_exchange(v[i], v[i+d]);
+    for(int i=0; i<K; i++) v[i] = bitonic_clean8(v[i]);
+}
+
+// Merges the sorted runs of K registers 'a' and 'b', the smallest half in 'a'
+template<int K>
+__attribute__((target("avx2"), always_inline))
+inline void bitonic_merge(__m256i *a, __m256i *b) {
+    const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    for(int i=0; i<K/2; i++) swap(b[i], b[K-1-i]);
+    for(int i=0; i<K; i++) {
+        b[i] = _mm256_permutevar8x32_epi32(b[i], rev);
+        compare_exchange(a[i], b[i]);
+    }
+    bitonic_clean<K>(a);
+    bitonic_clean<K>(b);
+}
+
+__attribute__((target("avx2")))
+inline void sort_network_avx2(int *A, int n) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i pad = _mm256_set1_epi32(INT32_MAX);
+    __m256i r[8], mask[8];
+
+    for(int i=0; i<8; i++) {
+        mask[i] = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - 8*i), lane);
+        r[i] = (8*i < n) ? _mm256_blendv_epi8(pad, _mm256_maskload_epi32(A+8*i, mask[i]), mask[i]) : pad;
+    }
+
+    // Columns (optimal network of 19 comparators)
+    static constexpr int net[19][2] = {
+        {0,2}, {1,3}, {4,6}, {5,7}, {0,4}, {1,5}, {2,6}, {3,7}, {0,1}, {2,3},
+        {4,5}, {6,7}, {2,4}, {3,5}, {1,4}, {3,6}, {1,2}, {3,4}, {5,6}
+    };
+    for(auto &c : net) compare_exchange(r[c[0]], r[c[1]]);
+
+    // Transpose, each register is a sorted run
+    __m256i t[8], u[8];
+    for(int i=0; i<8; i+=2) {
+        t[i]   = _mm256_unpacklo_epi32(r[i], r[i+1]);
+        t[i+1] = _mm256_unpackhi_epi32(r[i], r[i+1]);
+    }
+    for(int i=0; i<8; i+=4) {
+        u[i]   = _mm256_unpacklo_epi64(t[i], t[i+2]);
+        u[i+1] = _mm256_unpackhi_epi64(t[i], t[i+2]);
+        u[i+2] = _mm256_unpacklo_epi64(t[i+1], t[i+3]);
+        u[i+3] = _mm256_unpackhi_epi64(t[i+1], t[i+3]);
+    }
+    for(int i=0; i<4; i++) {
+        r[i]   = _mm256_permute2x128_si256(u[i], u[i+4], 0x20);
+        r[i+4] = _mm256_permute2x128_si256(u[i], u[i+4], 0x31);
+    }
+
+    // Runs of 16, 32 and 64 elements
+    for(int i=0; i<8; i+=2) bitonic_merge<1>(r+i, r+i+1);
+    for(int i=0; i<8; i+=4) bitonic_merge<2>(r+i, r+i+2);
+    bitonic_merge<4>(r, r+4);
+
+    for(int i=0; i<8 && 8*i < n; i++)
+        _mm256_maskstore_epi32(A+8*i, mask[i], r[i]);
+}
+
+template<typename T>
+using sort_network_fun = void (*)(T *, int);
+
+/*
+ * Sorting network for the element type and the ordering, nullptr if there
+ * is none for them or for the running CPU
+ */
+template<typename T, typename Compare = less<T>>
+inline sort_network_fun<T> select_sort_network() {
+    if constexpr (is_same_v<T, int> && is_same_v<Compare, less<T>>) {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")) return sort_network_avx2;
+    }
+    return nullptr;
+}
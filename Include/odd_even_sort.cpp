@@ -0,0 +1,689 @@
+#pragma once
+
+/*
+ * odd_even_sort.cpp
+ * Header-only interface to the implementations of the Odd-even Sort, to
+ * sort a buffer in place from another program:
+ *
+ *      odd_even_sort(v.begin(), v.end(), static_policy{8});
+ *      odd_even_sort(data, n, dynamic_policy{8, 0}, key_less<&Record::key>());
+ *
+ * With a WorkerPool as first argument the threads of the pool are reused,
+ * instead of creating new ones at each call:
+ *
+ *      WorkerPool pool(8);
+ *      odd_even_sort(pool, v.begin(), v.end(), static_policy{8});
+ *
+ * Many independent arrays can be sorted at once from a flat buffer and the
+ * offsets of the segments, see odd_even_sort_segments.
+ * Records with a large payload can be sorted by key, moving each record
+ * once, see odd_even_sort_by_key and odd_even_argsort.
+ * A sorted array with a few changed elements is re-sorted comparing only
+ * the couples near the displaced elements, see odd_even_resort.
+ *
+ * The buffer must be contiguous (vector, array, pointers). The comparator,
+ * as for sort_couples, is a stateless type and is default constructed.
+ * Nothing is printed and the elements are not copied, except for the
+ * private blocks of the merge-split. The calling thread is one of the
+ * workers and the termination is decided at the barrier (no master thread).
+ * Returns the number of iterations (rounds for the block version). The
+ * sequential policy sorts the arrays of at most SMALL_SORT elements with a
+ * sorting network where the CPU has one for the type (see
+ * select_sort_network), and then returns 0: the count depends on the CPU
+ * and is not the number of iterations of the classical version.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <functional>
+#include <climits>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+
+#include "business_logic.cpp"
+#include "HybridBarrier.cpp"
+#include "TaskManager.cpp"
+#include "WorkerPool.cpp"
+
+using namespace std;
+
+// Execution policies
+struct sequential_policy {};
+struct static_policy { int nw; };                     // Static division of the work
+struct dynamic_policy { int nw; int chunksize = 0; }; // TaskManager, 0 => adaptive chunks
+struct block_policy { int nw; };                      // Block merge-split
+
+inline int policy_workers(sequential_policy) { return 1; }
+template<typename Policy> int policy_workers(Policy p) { return p.nw; }
+
+
+/*
+ * Runs the workers on new threads, the calling thread is worker 0
+ * Same interface as WorkerPool
+ */
+struct ThreadTeam {
+    int max_workers() {
+        return INT_MAX;
+    }
+
+    template<typename F>
+    void run(int nw, F worker) {
+        vector<thread> team;
+        for(int t=1; t<nw; t++)
+            team.emplace_back(worker, t);
+        worker(0);
+        for(auto &th : team) th.join();
+    }
+};
+
+template<typename T, typename Compare, typename Team>
+unsigned long odd_even_run(Team &, T *A, int n, sequential_policy) {
+    // Small arrays (e.g. short segments) with a sorting network, no iterations
+    sort_network_fun<T> network = select_sort_network<T, Compare>();
+    if(n <= SMALL_SORT && network) {
+        network(A, n);
+        return 0;
+    }
+
+    sort_couples_fun<T> sort_fn = select_sort_couples<T, Compare>();
+
+    unsigned long iter = 0;
+    bool swapped = true;
+    while(swapped) {
+        iter++;
+        swapped = sort_fn(A, 0, n);
+        swapped |= (sort_fn(A, 1, n) > 0);
+    }
+    return iter;
+}
+
+template<typename T, typename Compare, typename Team>
+unsigned long odd_even_run(Team &team, T *A, int n, static_policy p) {
+    sort_couples_fun<T> sort_fn = select_sort_couples<T, Compare>();
+    int nw = max(1, min({p.nw, n/2, team.max_workers()}));
+
+    unsigned long iter = 0;
+    HybridBarrier phase_barrier(nw), iter_barrier(nw);
+
+    team.run(nw, [&] (int t) {
+        int lo, hi;
+        even_partition(n, nw, t, &lo, &hi);
+        int end_o = (t == nw-1) ? n : hi+1;
+
+        while(true) {
+            int nswaps = sort_fn(A, lo, hi);
+            phase_barrier.wait(t, 0);
+            nswaps |= sort_fn(A, lo+1, end_o);
+
+            auto count = [&] (unsigned long) { iter++; };
+            if(!iter_barrier.wait(t, nswaps != 0, count)) break;
+        }
+    });
+    return iter;
+}
+
+template<typename T, typename Compare, typename Team>
+unsigned long odd_even_run(Team &team, T *A, int n, dynamic_policy p) {
+    sort_couples_fun<T> sort_fn = select_sort_couples<T, Compare>();
+    int nw = max(1, min({p.nw, n/2, team.max_workers()}));
+    int chunksize = (p.chunksize > 0) ? max(2, p.chunksize + p.chunksize%2) : 0;
+
+    unsigned long iter = 0;
+    HybridBarrier phase_barrier(nw), iter_barrier(nw);
+
+    TaskManager tm(chunksize, n);
+    tm.set_workers(nw, [&] (int t, int *lo, int *hi) { even_partition(n, nw, t, lo, hi); },
+                   vector<int>(nw, 0));
+    tm.set_index(0);
+
+    team.run(nw, [&] (int t) {
+        auto phase = [&] () {
+            int s, e, nswaps = 0;
+            while(tm.get_task(t, &s, &e)) {
+                int k = sort_fn(A, s, e);
+                tm.done(t, k);
+                nswaps |= k;
+            }
+            return nswaps;
+        };
+
+        while(true) {
+            int nswaps = phase();
+            phase_barrier.wait(t, 0, [&] (unsigned long) { tm.set_index(1); });
+            nswaps |= phase();
+
+            // The last worker prepares the tasks of the next iteration
+            auto next = [&] (unsigned long all) {
+                iter++;
+                if(all) tm.set_index(0);
+            };
+            if(!iter_barrier.wait(t, nswaps != 0, next)) break;
+        }
+    });
+    return iter;
+}
+
+template<typename T, typename Compare, typename Team>
+unsigned long odd_even_run(Team &team, T *A, int n, block_policy p) {
+    Compare comp;
+    int nw = max(1, min({p.nw, n/2, team.max_workers()})); // An empty block would separate its neighbours
+
+    unsigned long iter = 0;
+    HybridBarrier barrier(nw);
+
+    team.run(nw, [&] (int t) {
+        int lo, hi;
+        even_partition(n, nw, t, &lo, &hi);
+        vector<T> B(hi-lo); // Private result of the merge-split
+
+        // Merge-split with the neighbour 'm', see merge_split_blocks
+        auto merge_split = [&] (int m) {
+            if(m < 0 || m >= nw) return false;
+
+            int mlo, mhi;
+            even_partition(n, nw, m, &mlo, &mhi);
+            return merge_split_blocks(A, lo, hi, mlo, mhi, B.data(), comp);
+        };
+
+        sort_network_fun<T> network = select_sort_network<T, Compare>();
+        if(hi-lo <= SMALL_SORT && network) network(A+lo, hi-lo);
+        else sort(A+lo, A+hi, comp);
+        barrier.wait(t, 0);
+
+        int even_n = (t%2 == 0) ? t+1 : t-1;
+        int odd_n  = (t%2 == 0) ? t-1 : t+1;
+
+        while(true) {
+            bool changed = merge_split(even_n), swapped = changed;
+            barrier.wait(t, 0);
+            if(changed) copy(B.begin(), B.end(), A+lo);
+            barrier.wait(t, 0);
+
+            changed = merge_split(odd_n);
+            swapped |= changed;
+            barrier.wait(t, 0);
+            if(changed) copy(B.begin(), B.end(), A+lo);
+
+            if(!barrier.wait(t, swapped, [&] (unsigned long) { iter++; })) break;
+        }
+    });
+    return iter;
+}
+
+
+/*
+ * Sorts the 'n' elements of 'data' with the given policy, on the threads
+ * of 'pool'
+ */
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_sort(WorkerPool &pool, T *data, size_t n, Policy policy, Compare = Compare()) {
+    if(n < 2) return 0;
+    return odd_even_run<T, Compare>(pool, data, (int)n, policy);
+}
+
+template<typename RandomIt, typename Policy,
+         typename Compare = less<typename iterator_traits<RandomIt>::value_type>>
+unsigned long odd_even_sort(WorkerPool &pool, RandomIt first, RandomIt last, Policy policy, Compare comp = Compare()) {
+    if(last - first < 2) return 0;
+    return odd_even_sort(pool, &*first, last - first, policy, comp);
+}
+
+/*
+ * Sorts the 'n' elements of 'data' with the given policy
+ */
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_sort(T *data, size_t n, Policy policy, Compare = Compare()) {
+    if(n < 2) return 0;
+    ThreadTeam team;
+    return odd_even_run<T, Compare>(team, data, (int)n, policy);
+}
+
+/*
+ * Sorts the contiguous range [first, last) with the given policy
+ */
+template<typename RandomIt, typename Policy,
+         typename Compare = less<typename iterator_traits<RandomIt>::value_type>>
+unsigned long odd_even_sort(RandomIt first, RandomIt last, Policy policy, Compare comp = Compare()) {
+    if(last - first < 2) return 0;
+    return odd_even_sort(&*first, last - first, policy, comp);
+}
+
+
+/*
+ * Sorts independently the segments [offsets[i], offsets[i+1]) of 'data'
+ * The segments shorter than 'threshold' are sorted each by a single
+ * worker, that takes them one at a time from a shared counter, with the
+ * sequential version; the others are sorted one at a time by all the
+ * workers with 'policy', which also gives the number of workers.
+ * Returns the total number of iterations (the segments sorted with the
+ * sorting network count 0, see odd_even_sort)
+ */
+template<typename T, typename Compare, typename Team, typename Policy>
+unsigned long odd_even_run_segments(Team &team, T *data, const vector<size_t> &offsets,
+                                    Policy policy, size_t threshold) {
+    int nseg = (int)offsets.size() - 1;
+    if(nseg <= 0) return 0;
+
+    vector<int> small, large;
+    for(int i=0; i<nseg; i++)
+        ((offsets[i+1] - offsets[i] < threshold) ? small : large).push_back(i);
+
+    atomic<unsigned long> iter = 0;
+
+    // Small segments, each on a single worker
+    int nw = max(1, min({policy_workers(policy), (int)small.size(), team.max_workers()}));
+    atomic<int> next = 0;
+    if(!small.empty()) {
+        team.run(nw, [&] (int) {
+            sequential_policy seq;
+            unsigned long local = 0;
+            for(int k=next++; k<(int)small.size(); k=next++) {
+                size_t lo = offsets[small[k]], hi = offsets[small[k]+1];
+                if(hi - lo >= 2) local += odd_even_run<T, Compare>(team, data+lo, (int)(hi-lo), seq);
+            }
+            iter += local;
+        });
+    }
+
+    // Large segments, each on all the workers
+    for(int i : large)
+        iter += odd_even_run<T, Compare>(team, data+offsets[i], (int)(offsets[i+1]-offsets[i]), policy);
+
+    return iter;
+}
+
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_sort_segments(WorkerPool &pool, T *data, const vector<size_t> &offsets,
+                                     Policy policy, size_t threshold = 1 << 14, Compare = Compare()) {
+    return odd_even_run_segments<T, Compare>(pool, data, offsets, policy, threshold);
+}
+
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_sort_segments(T *data, const vector<size_t> &offsets,
+                                     Policy policy, size_t threshold = 1 << 14, Compare = Compare()) {
+    ThreadTeam team;
+    return odd_even_run_segments<T, Compare>(team, data, offsets, policy, threshold);
+}
+
+
+/*
+ * Sort by key with deferred payload movement
+ * Each element may be moved O(n) times, so the records with a large payload
+ * are not sorted themselves: their keys are sorted together with the
+ * original positions, with the same policies and kernels, then the
+ * permutation is applied to the records once (each record is copied to a
+ * buffer and back). The key is the one of the comparator, the element
+ * itself for less<T> and the member or function of key_less. Modes:
+ *      key_packed : key and position in a 64-bit word, sorted with the
+ *                   (vectorized) int64_t kernels; for arithmetic keys of
+ *                   at most 32 bits, the others fall back to key_stable.
+ *                   Floating point keys are ordered by their bits, so -0
+ *                   comes before +0
+ *      key_pairs  : (key, position) couples compared on the key
+ *      key_stable : (key, position) couples compared on the key, then on
+ *                   the position
+ * All the modes give a permutation of the elements with every policy.
+ * key_packed and key_stable are also stable with every policy. The
+ * element-wise policies and the merge-split never exchange equal keys, so
+ * key_pairs is stable with them too, but not with block_policy, whose blocks
+ * are first sorted with std::sort.
+ */
+enum key_mode { key_packed, key_pairs, key_stable };
+
+// Key extracted by a comparator
+template<typename Compare> struct comparator_key;
+
+template<typename T>
+struct comparator_key<less<T>> {
+    static const T &get(const T &a) { return a; }
+};
+
+template<auto Key>
+struct comparator_key<key_less<Key>> {
+    template<typename T>
+    static decltype(auto) get(const T &a) { return invoke(Key, a); }
+};
+
+template<typename K>
+struct KeyIndex {
+    K key;
+    uint32_t index;
+};
+
+// Orders the couples with equal keys by position
+struct key_index_less {
+    template<typename P>
+    bool operator()(const P &a, const P &b) const {
+        return (a.key < b.key) || (!(b.key < a.key) && a.index < b.index);
+    }
+};
+
+/*
+ * Signed 32-bit word with the same order of the key, for key_packed
+ */
+template<typename K>
+inline int32_t ordered_bits(K k) {
+    if constexpr (is_floating_point_v<K>) {
+        int32_t b;
+        memcpy(&b, &k, sizeof(b));
+        return (b < 0) ? b ^ 0x7FFFFFFF : b;
+    } else if constexpr (is_unsigned_v<K>)
+        return (int32_t)((uint32_t)k ^ 0x80000000u);
+    else
+        return (int32_t)k;
+}
+
+template<typename K>
+constexpr bool is_packable_key = is_arithmetic_v<K> && sizeof(K) <= 4;
+
+/*
+ * Sorts the keys of 'data' with their positions; with 'perm' the positions
+ * in sorted order are written there and the elements are not moved,
+ * otherwise the elements are permuted
+ */
+template<typename T, typename Compare, typename Team, typename Policy>
+unsigned long odd_even_run_by_key(Team &team, T *data, int n, Policy policy, key_mode mode, uint32_t *perm) {
+    using Key = decay_t<decltype(comparator_key<Compare>::get(*data))>;
+    int nw = max(1, min({policy_workers(policy), n/2, team.max_workers()}));
+
+    // Runs 'f(lo, hi)' on a part of [0, n) on each worker
+    auto parallel_for = [&] (auto f) {
+        team.run(nw, [&] (int t) { f((long)n*t/nw, (long)n*(t+1)/nw); });
+    };
+
+    unique_ptr<uint32_t[]> order;
+    if(!perm) {
+        order.reset(new uint32_t[n]);
+        perm = order.get();
+    }
+
+    auto sort_pairs = [&] () {
+        using P = KeyIndex<Key>;
+        unique_ptr<P[]> W(new P[n]);
+        parallel_for([&] (long lo, long hi) {
+            for(long i=lo; i<hi; i++) W[i] = {comparator_key<Compare>::get(data[i]), (uint32_t)i};
+        });
+
+        unsigned long iter = (mode == key_pairs)
+            ? odd_even_run<P, key_less<&P::key>>(team, W.get(), n, policy)
+            : odd_even_run<P, key_index_less>(team, W.get(), n, policy);
+
+        parallel_for([&] (long lo, long hi) {
+            for(long i=lo; i<hi; i++) perm[i] = W[i].index;
+        });
+        return iter;
+    };
+
+    unsigned long iter;
+    if constexpr (is_packable_key<Key>) {
+        if(mode == key_packed) {
+            unique_ptr<int64_t[]> W(new int64_t[n]);
+            parallel_for([&] (long lo, long hi) {
+                for(long i=lo; i<hi; i++) {
+                    uint32_t k = ordered_bits(comparator_key<Compare>::get(data[i]));
+                    W[i] = (int64_t)(((uint64_t)k << 32) | (uint64_t)i);
+                }
+            });
+
+            iter = odd_even_run<int64_t, less<int64_t>>(team, W.get(), n, policy);
+
+            parallel_for([&] (long lo, long hi) {
+                for(long i=lo; i<hi; i++) perm[i] = (uint32_t)W[i];
+            });
+        } else iter = sort_pairs();
+    } else iter = sort_pairs();
+
+    // The elements are moved once, to a buffer and back
+    if(order) {
+        unique_ptr<T[]> B(new T[n]);
+        parallel_for([&] (long lo, long hi) {
+            for(long i=lo; i<hi; i++) B[i] = data[perm[i]];
+        });
+        parallel_for([&] (long lo, long hi) {
+            copy(B.get()+lo, B.get()+hi, data+lo);
+        });
+    }
+    return iter;
+}
+
+/*
+ * Sorts the 'n' elements of 'data' by key, moving each element once
+ */
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_sort_by_key(WorkerPool &pool, T *data, size_t n, Policy policy,
+                                   Compare = Compare(), key_mode mode = key_packed) {
+    if(n < 2) return 0;
+    return odd_even_run_by_key<T, Compare>(pool, data, (int)n, policy, mode, nullptr);
+}
+
+template<typename RandomIt, typename Policy,
+         typename Compare = less<typename iterator_traits<RandomIt>::value_type>>
+unsigned long odd_even_sort_by_key(WorkerPool &pool, RandomIt first, RandomIt last, Policy policy,
+                                   Compare comp = Compare(), key_mode mode = key_packed) {
+    if(last - first < 2) return 0;
+    return odd_even_sort_by_key(pool, &*first, last - first, policy, comp, mode);
+}
+
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_sort_by_key(T *data, size_t n, Policy policy,
+                                   Compare = Compare(), key_mode mode = key_packed) {
+    if(n < 2) return 0;
+    ThreadTeam team;
+    return odd_even_run_by_key<T, Compare>(team, data, (int)n, policy, mode, nullptr);
+}
+
+template<typename RandomIt, typename Policy,
+         typename Compare = less<typename iterator_traits<RandomIt>::value_type>>
+unsigned long odd_even_sort_by_key(RandomIt first, RandomIt last, Policy policy,
+                                   Compare comp = Compare(), key_mode mode = key_packed) {
+    if(last - first < 2) return 0;
+    return odd_even_sort_by_key(&*first, last - first, policy, comp, mode);
+}
+
+/*
+ * Argsort: 'perm[k]' is the position in 'data' of the k-th element in
+ * sorted order, the elements are not moved
+ */
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_argsort(WorkerPool &pool, const T *data, size_t n, vector<uint32_t> &perm,
+                               Policy policy, Compare = Compare(), key_mode mode = key_packed) {
+    perm.resize(n);
+    if(n == 1) perm[0] = 0;
+    if(n < 2) return 0;
+    return odd_even_run_by_key<T, Compare>(pool, const_cast<T *>(data), (int)n, policy, mode, perm.data());
+}
+
+template<typename T, typename Policy, typename Compare = less<T>>
+unsigned long odd_even_argsort(const T *data, size_t n, vector<uint32_t> &perm,
+                               Policy policy, Compare = Compare(), key_mode mode = key_packed) {
+    perm.resize(n);
+    if(n == 1) perm[0] = 0;
+    if(n < 2) return 0;
+    ThreadTeam team;
+    return odd_even_run_by_key<T, Compare>(team, const_cast<T *>(data), (int)n, policy, mode, perm.data());
+}
+
+
+/*
+ * Incremental re-sort
+ * 'data' was sorted and the elements in the positions 'modified' have been
+ * changed since: only the couples that can still be out of order are
+ * compared, in active windows of consecutive elements. Outside the windows
+ * every couple is in order. A phase compares the couples of its parity in
+ * the windows, and the windows of the next phase are the neighbourhoods of
+ * the exchanges just made: exchanging (j, j+1) can only put (j-1, j) and
+ * (j+1, j+2) out of order, while the couples of the other parity were put
+ * in order by the previous phase (the second phase also covers the initial
+ * windows, where the couples of both parities may be out of order). So the
+ * windows follow the displaced elements, growing where the exchanges spread
+ * and shrinking where they stop, and the work is proportional to the
+ * displacement rather than to n; it ends at the first phase with no
+ * windows. A couple of a window costs tens of times more than one of a
+ * phase on the whole array with the vectorized kernels, so when the windows
+ * hold more than n/64 couples the remaining phases are run on the whole
+ * array, as in the static version, until a phase with no exchanges.
+ * The policy only gives the number of workers: the couples of the windows
+ * of a phase are split evenly among them, one worker every 'grain' couples,
+ * and the windows of the next phase are gathered at the barrier.
+ */
+struct resort_stats {
+    unsigned long phases = 0;      // Phases run
+    unsigned long full_phases = 0; // Phases run on the whole array
+    unsigned long couples = 0;     // Couples compared, in all the phases
+    unsigned long swaps = 0;
+    size_t max_active = 0;         // Most elements in the windows of a phase
+    size_t max_windows = 0;        // Most windows in a phase
+};
+
+template<typename T, typename Compare, typename Team, typename Policy>
+resort_stats odd_even_run_resort(Team &team, T *A, long n, const vector<size_t> &modified,
+                                 Policy policy, long grain) {
+    using Window = pair<long, long>; // First and last element
+    static constexpr long full_ratio = 64;
+    Compare comp;
+    sort_couples_fun<T> sort_fn = select_sort_couples<T, Compare>();
+    resort_stats st;
+
+    // Appends [lo, hi] to the windows 'w', sorted by 'lo', merging the overlapping ones
+    auto add = [] (vector<Window> &w, long lo, long hi) {
+        if(!w.empty() && lo <= w.back().second) w.back().second = max(w.back().second, hi);
+        else w.push_back({lo, hi});
+    };
+
+    vector<size_t> mod(modified);
+    sort(mod.begin(), mod.end());
+    vector<Window> initial, cur, spare;
+    for(size_t i : mod)
+        if(i < (size_t)n) add(initial, max(0L, (long)i-1), min(n-1, (long)i+1));
+    if(initial.empty()) return st;
+    cur = initial;
+
+    int nw = (int)max(1L, min({(long)policy_workers(policy), n/2, (long)team.max_workers()}));
+    grain = max(grain, 1L);
+
+    vector<vector<Window>> found(nw); // Windows of the exchanges of each worker
+    vector<unsigned long> swaps(nw);
+    vector<long> first;               // First couple of each window, in the phase
+    long total = 0;                   // Couples of the phase
+    int par = 0, active = 1;
+    bool full = false, done = false;
+
+    // Couples of the windows for the parity 'par', and workers of the phase
+    auto prepare = [&] () {
+        first.assign(cur.size()+1, 0);
+        size_t elems = 0;
+        for(size_t w=0; w<cur.size(); w++) {
+            long j0 = cur[w].first + ((cur[w].first ^ par) & 1);
+            first[w+1] = first[w] + max(0L, (cur[w].second - j0 + 1)/2);
+            elems += cur[w].second - cur[w].first + 1;
+        }
+        total = first[cur.size()];
+        active = (int)max(1L, min((long)nw, total/grain));
+
+        st.phases++;
+        st.max_active = max(st.max_active, elems);
+        st.max_windows = max(st.max_windows, cur.size());
+        if(total > n/full_ratio) {
+            full = true;
+            st.full_phases++;
+            st.couples += (n - par)/2;
+        } else st.couples += total;
+    };
+
+    // Couples [total*t/active, total*(t+1)/active) of the phase
+    auto phase = [&] (int t) {
+        found[t].clear();
+        swaps[t] = 0;
+        if(full) {
+            int lo, hi;
+            even_partition((int)n, nw, t, &lo, &hi);
+            swaps[t] = (par == 0) ? sort_fn(A, lo, hi) : sort_fn(A, lo+1, (t == nw-1) ? (int)n : hi+1);
+            return;
+        }
+        if(t >= active) return;
+
+        long c = total*t/active, c_end = total*(t+1)/active;
+        size_t w = upper_bound(first.begin(), first.end(), c) - first.begin() - 1;
+        for(; c < c_end; w++) {
+            long j = cur[w].first + ((cur[w].first ^ par) & 1) + 2*(c - first[w]);
+            long last = min(first[w+1], c_end);
+            for(; c < last; c++, j+=2) {
+                if(comp(A[j+1], A[j])) {
+                    swap(A[j], A[j+1]);
+                    swaps[t]++;
+                    add(found[t], max(0L, j-1), min(n-1, j+2));
+                }
+            }
+        }
+    };
+
+    // Windows of the next phase, merged in order of position
+    auto next = [&] () {
+        unsigned long phase_swaps = 0;
+        for(int t=0; t<nw; t++) phase_swaps += swaps[t];
+        st.swaps += phase_swaps;
+
+        // The couples of the other parity were put in order by the previous phase
+        if(full) {
+            done = (phase_swaps == 0 && st.phases > 1);
+            par ^= 1;
+            if(!done) {
+                st.phases++;
+                st.full_phases++;
+                st.couples += (n - par)/2;
+            }
+            return;
+        }
+
+        vector<Window> &w = spare;
+        w.clear();
+        size_t k = 0;
+        for(int t=0; t<nw; t++) {
+            for(auto &f : found[t]) {
+                if(par == 0)
+                    for(; k < initial.size() && initial[k].first <= f.first; k++)
+                        add(w, initial[k].first, initial[k].second);
+                add(w, f.first, f.second);
+            }
+        }
+        if(par == 0)
+            for(; k < initial.size(); k++) add(w, initial[k].first, initial[k].second);
+
+        cur.swap(w);
+        par ^= 1;
+        done = cur.empty();
+        if(!done) prepare();
+    };
+
+    prepare();
+    HybridBarrier barrier(nw);
+    team.run(nw, [&] (int t) {
+        while(true) {
+            phase(t);
+            barrier.wait(t, 0, [&] (unsigned long) { next(); });
+            if(done) break;
+        }
+    });
+    return st;
+}
+
+/*
+ * Re-sorts the 'n' elements of 'data', sorted before the elements in the
+ * positions 'modified' were changed
+ */
+template<typename T, typename Policy, typename Compare = less<T>>
+resort_stats odd_even_resort(WorkerPool &pool, T *data, size_t n, const vector<size_t> &modified,
+                             Policy policy, Compare = Compare(), size_t grain = 1 << 12) {
+    return odd_even_run_resort<T, Compare>(pool, data, (long)n, modified, policy, (long)grain);
+}
+
+template<typename T, typename Policy, typename Compare = less<T>>
+resort_stats odd_even_resort(T *data, size_t n, const vector<size_t> &modified,
+                             Policy policy, Compare = Compare(), size_t grain = 1 << 12) {
+    ThreadTeam team;
+    return odd_even_run_resort<T, Compare>(team, data, (long)n, modified, policy, (long)grain);
+}
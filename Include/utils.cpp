@@ -1,3 +1,5 @@
+#pragma once
+
 /*
  * utilis.cpp
  * Contains some utility functions to be used among all implementations
@@ -8,52 +10,174 @@
 #include <numeric>
 #include <algorithm>
 #include <random>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "business_logic.cpp"
+#include "Generators.cpp"
 
 using namespace std;
 
+/*
+ * Looks for the option 'name' in the command line, and removes it
+ * together with its value so that the positional arguments are unaffected
+ *		argc, argv : command line arguments
+ *		name       : option name, e.g. "-k"
+ *		def        : value returned when the option is not present
+ */
+const char *get_option(int &argc, char const *argv[], const char *name, const char *def) {
+	for(int i=1; i<argc-1; i++) {
+		if(strcmp(argv[i], name) != 0) continue;
+
+		const char *value = argv[i+1];
+		for(int j=i; j<argc-2; j++)
+			argv[j] = argv[j+2];
+		argc -= 2;
+		return value;
+	}
+	return def;
+}
+
+int get_option(int &argc, char const *argv[], const char *name, int def) {
+	const char *value = get_option(argc, argv, name, (const char *)nullptr);
+	return (value) ? atoi(value) : def;
+}
+
+/*
+ * Looks for the flag 'name' (an option without value) in the command
+ * line, and removes it. Returns true if it was present
+ */
+bool get_flag(int &argc, char const *argv[], const char *name) {
+	for(int i=1; i<argc; i++) {
+		if(strcmp(argv[i], name) != 0) continue;
+
+		for(int j=i; j<argc-1; j++)
+			argv[j] = argv[j+1];
+		argc -= 1;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Fixed-size record sorted by its key, to test the generic kernels
+ * and the sort by key (see odd_even_sort_by_key)
+ */
+template<int Words>
+struct BasicRecord {
+	int key;
+	int payload[Words];
+
+	BasicRecord() = default;
+	explicit BasicRecord(int k) : key(k) {
+		for(int i=0; i<Words; i++) payload[i] = k;
+	}
+};
+
+using Record = BasicRecord<3>;      // 16 bytes
+using WideRecord = BasicRecord<15>; // 64 bytes
+
+template<int Words>
+ostream &operator<<(ostream &os, const BasicRecord<Words> &r) {
+	return os << r.key;
+}
+
+/*
+ * Element type and ordering, see dispatch_type
+ */
+template<typename T, typename Compare = less<T>>
+struct type_tag {
+	using type = T;
+	using compare = Compare;
+};
+
+/*
+ * Calls 'f' with the type_tag of the element type named 'name'
+ *		int, int64, float, double, record or record64 (sorted by key)
+ * Returns -1 if the name is unknown
+ */
+template<typename F>
+int dispatch_type(const char *name, F f) {
+	if(strcmp(name, "int") == 0)    return f(type_tag<int>());
+	if(strcmp(name, "int64") == 0)  return f(type_tag<int64_t>());
+	if(strcmp(name, "float") == 0)  return f(type_tag<float>());
+	if(strcmp(name, "double") == 0) return f(type_tag<double>());
+	if(strcmp(name, "record") == 0) return f(type_tag<Record, key_less<&Record::key>>());
+	if(strcmp(name, "record64") == 0) return f(type_tag<WideRecord, key_less<&WideRecord::key>>());
+
+	cout << "Unknown element type " << name << endl;
+	return -1;
+}
+
+/*
+ * Allocator that does not initialize the elements, so that the pages of a
+ * vector are touched first by the thread that writes them (see first_touch_fill)
+ */
+template<typename T>
+struct default_init_allocator : allocator<T> {
+	template<typename U> struct rebind { using other = default_init_allocator<U>; };
+
+	using allocator<T>::allocator;
+
+	template<typename U>
+	void construct(U *p) noexcept(is_nothrow_default_constructible_v<U>) {
+		::new((void *)p) U;
+	}
+	template<typename U, typename... Args>
+	void construct(U *p, Args&&... args) {
+		::new((void *)p) U(forward<Args>(args)...);
+	}
+};
+
 /*
  * Prints the content of the vector
  * 		v : vector to be printed
  */
-void print_vector(vector<int> v) {
+template<typename T, typename Alloc>
+void print_vector(const vector<T, Alloc> &v) {
     for(auto it = v.begin(); it != v.end(); it++)
         cout << *it << " ";
     cout << endl;
 }
 
 /*
- * Fills the vector with random numbers
+ * Name of the input distribution (see Generators.cpp) of the default problem
+ *		seed  : seed for the random number generator (-1 => reversed vector)
+ *		niter : upper bound for the number of iterations (0 => random)
+ */
+string problem_input(int seed, int niter) {
+	if(seed == -1) return "reversed";
+	if(niter == 0) return "random";
+	return "iter" + to_string(niter);
+}
+
+/*
+ * Fills the vector with a random permutation of 0..N-1, on 'nw' threads
+ * (0 => all the cores), the same for any number of threads
  *		v    : vector to be filled
  *		seed : seed for the random number generator
  */
-void fill_random(vector<int> &v, int seed) {
-	iota(v.begin(), v.end(), 0);
-	shuffle(v.begin(), v.end(), default_random_engine(seed));
+template<typename T, typename Alloc>
+void fill_random(vector<T, Alloc> &v, int seed, int nw = 0) {
+	generate_input(v, "random", seed, nw);
 }
 
 /*
  * Fills the vector such that the sorting can be performed in at
- * most 'niter' iterations
+ * most 'niter' iterations, on 'nw' threads (0 => all the cores)
  *		v     : vector to be filled
  *		seed  : seed for the random number generator
- *		niter : upper bound for the number of iterations
+ *		niter : upper bound for the number of iterations, at least 1
+ *		        (a smaller one is taken as 1)
+ * Any seed gives this problem, -1 too
  */
-void fill_for_fixed_iterations(vector<int> &v, int seed, int niter) {
-	iota(v.begin(), v.end(), 0);
-	if(niter == 1) return;
-	niter--;
-
-	srand(seed);
-
-	for(int i=0; i<(int)v.size(); i++) {
-		if(i != v[i]) continue;
-
-		int min_idx = max(0, i - 2*niter);
-		int max_idx = min((int)v.size()-1, i + 2*niter);
-
-		int idx = min_idx + rand() % (max_idx - min_idx);
-		if(idx == v[idx]) swap(v[i], v[idx]);
-	}
+template<typename T, typename Alloc>
+void fill_for_fixed_iterations(vector<T, Alloc> &v, int seed, int niter, int nw = 0) {
+	if(niter < 1) niter = 1;
+	generate_input(v, ("iter" + to_string(niter)).c_str(), seed, nw);
 }
 
 /*
@@ -62,7 +186,23 @@ void fill_for_fixed_iterations(vector<int> &v, int seed, int niter) {
  * iteration
  *		v : vector to be filled
  */
-void fill_reversed(vector<int> &v) {
-	iota(v.begin(), v.end(), 0);
-	reverse(v.begin(), v.end());
-}
\ No newline at end of file
+template<typename T, typename Alloc>
+void fill_reversed(vector<T, Alloc> &v, int nw = 0) {
+	generate_input(v, "reversed", 0, nw);
+}
+
+/*
+ * Fills the vector with one of the problems above, converted to the
+ * element type, on 'nw' threads (0 => all the cores)
+ * The engines that place the array on the nodes of the workers generate
+ * the same problem with first_touch_fill and problem_input
+ *		v     : vector to be filled
+ *		seed  : seed for the random number generator (-1 => reversed vector)
+ *		niter : upper bound for the number of iterations (0 => random)
+ */
+template<typename T, typename Alloc>
+void fill_problem(vector<T, Alloc> &v, int seed, int niter, int nw = 0) {
+	if(seed == -1) fill_reversed(v, nw);
+	else if(niter == 0) fill_random(v, seed, nw);
+	else fill_for_fixed_iterations(v, seed, niter, nw);
+}
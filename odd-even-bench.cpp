@@ -0,0 +1,633 @@
+/*
+ * ---- odd-even-bench.cpp
+ *
+ * Benchmark driver: runs the engines in-process, sweeping the number of
+ * workers, the chunksize, the size and the input distribution of the
+ * problem. Each configuration is run with warmup and repeated trials, and
+ * reported with the min, median (mean of the two middle trials if they are
+ * even) and 95th percentile of the time, plus speedup and efficiency of the
+ * median over the sequential version on the same problem. The result of
+ * every trial is compared with a sorted copy of the problem (by segments for
+ * the segments engines), a wrong one stops the benchmark with an error; the
+ * records carry their position in the payload, so with -t record and a fewK
+ * input (many equal keys) an element duplicated or lost by an exchange of
+ * equal keys is found too. By key, the permutation of odd_even_argsort is
+ * also checked to be a permutation of 0..N-1 that sorts the problem.
+ * The engines are:
+ *      seq, static, dyn, block, ff : the code of the executables
+ *              (odd_even_seq, odd_even_par_static, ..., see SeqEngine.cpp
+ *              and the like in Include), with the same barriers, placement
+ *              and options
+ *      pool-static, pool-dyn, pool-block : the library interface
+ *              (odd_even_sort.cpp) on a WorkerPool created once for each
+ *              number of workers
+ *      lib-static, lib-dyn, lib-block : the same calls, creating the
+ *              threads at each sort (as compared by odd-even-pool)
+ *      segments, segments-each : the segmented mode (odd_even_sort_segments)
+ *              and the segments sorted one at a time, static_policy on the
+ *              pool, on the array cut into segments of random lengths (-g);
+ *              their baseline is the segmented mode with sequential_policy,
+ *              run as segments-seq
+ *      resort : the incremental re-sort (odd_even_resort, static_policy on
+ *              the pool), on the changedK inputs only
+ *      dist   : odd-even-dist with nw ranks, the time includes the start of
+ *              the processes and the copy of the result from a shared mapping
+ *      file   : odd-even-file, on a file written with the problem before each
+ *              trial (in the current directory, removed at the end)
+ * With -k the records are also sorted by key (odd_even_sort_by_key, only
+ * the library engines and the sequential baseline, with sequential_policy),
+ * and the bytes moved by each mode are reported: an exchange of adjacent
+ * elements removes exactly one inversion, so the element-wise engines move
+ * 2 elements per inversion of the input (not counted for the block, dist,
+ * file and segments engines).
+ * Takes no arguments, the options are comma-separated lists:
+ *      -e engines : seq, static, dyn, block, ff (only if FastFlow is
+ *                   available), pool-static, pool-dyn, pool-block,
+ *                   lib-static, lib-dyn, lib-block, segments, segments-each,
+ *                   resort, dist, file
+ *                   (default seq,static,dyn,block and ff); the sequential
+ *                   version is always run, as the baseline
+ *      -n N       : array sizes (default 10000,50000)
+ *      -w nw      : numbers of workers, ranges allowed (default 1,2,4,8)
+ *      -c C       : chunksizes for dyn and ff (default 0 => adaptive for
+ *                   dyn, static block scheduling for ff)
+ *      -i inputs  : random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK,
+ *                   organ, zipfS (see Generators.cpp, default random), or
+ *                   changedK: sorted with K elements changed, as in
+ *                   odd-even-resort, sorted from scratch by the other engines
+ *      -k modes   : elements (sort the elements themselves, default),
+ *                   packed, pairs, stable (sort by key, see key_mode)
+ * and the options:
+ *      -x "opts"  : options of the engines, as on their command line, e.g.
+ *                   "-b tree -k 8 -p compact", "-x unix" or "-B 4096" (each
+ *                   engine takes the ones it knows, -a C applies to all)
+ *      -g min,max : lengths of the segments (default 64,4096)
+ *      -r R       : trials per configuration (default 5)
+ *      -u U       : warmup runs per configuration (default 1)
+ *      -b secs    : time budget per configuration, fewer trials are run
+ *                   once it is over (default 10)
+ *      -f format  : csv (default) or json, on the standard output
+ *      -t type    : element type (int, int64, float, double, record, record64)
+ *                   (record64 has a 60 bytes payload)
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-bench.cpp -o odd-even-bench
+ * (the ff engine is built when the FastFlow headers are in the include path)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+#include "utils.cpp"
+#include "Generators.cpp"
+#include "Affinity.cpp"
+#include "odd_even_sort.cpp"
+#include "SeqEngine.cpp"
+#include "StaticEngine.cpp"
+#include "DynEngine.cpp"
+#include "BlockEngine.cpp"
+#include "DistEngine.cpp"
+#include "FileEngine.cpp"
+
+#if __has_include(<ff/parallel_for.hpp>)
+#define HAVE_FF 1
+#include "FFEngine.cpp"
+#else
+#define HAVE_FF 0
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+
+/*
+ * Splits a comma-separated list of names
+ */
+vector<string> split_list(const string &list) {
+    vector<string> items;
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == string::npos) end = list.size();
+        if(end > pos) items.push_back(list.substr(pos, end-pos));
+        pos = end+1;
+    }
+    return items;
+}
+
+/*
+ * Inversions of 'v', i.e. couples i < j with comp(v[j], v[i]) (merge sort)
+ */
+template<typename T, typename Compare>
+unsigned long count_inversions(vector<T> v, Compare comp) {
+    vector<T> B(v.size());
+    unsigned long inv = 0;
+    long n = v.size();
+    for(long w=1; w<n; w*=2) {
+        for(long lo=0; lo<n; lo+=2*w) {
+            long mid = min(lo+w, n), hi = min(lo+2*w, n);
+            long i = lo, j = mid, k = lo;
+            while(i < mid && j < hi) {
+                if(comp(v[j], v[i])) {
+                    inv += mid - i;
+                    B[k++] = v[j++];
+                } else B[k++] = v[i++];
+            }
+            while(i < mid) B[k++] = v[i++];
+            while(j < hi)  B[k++] = v[j++];
+        }
+        swap(v, B);
+    }
+    return inv;
+}
+
+/*
+ * Offsets of the segments of an array of N elements, of random lengths
+ * between minlen and maxlen (the last one is cut at N)
+ */
+vector<size_t> segment_offsets(long N, int minlen, int maxlen) {
+    vector<size_t> offsets = { 0 };
+    for(long i=0; (long)offsets.back() < N; i++)
+        offsets.push_back(min<long>(N, offsets.back() + minlen + counter_rng(42, i) % (maxlen - minlen + 1)));
+    return offsets;
+}
+
+/*
+ * Input "changedK" of the resort engine, as in odd-even-resort: the sorted
+ * problem with K elements changed to the values of other random positions.
+ * 'modified' gets the changed positions
+ */
+template<typename T>
+void changed_input(vector<T> &P, long k, vector<size_t> &modified) {
+    long N = P.size();
+    generate_input(P, "sorted", 42);
+    vector<T> S = P;
+    modified.clear();
+    for(long m=0; m<k && N>0; m++) {
+        long i = counter_rng(42, 2*m) % N;
+        long pos = counter_rng(42, 2*m+1) % N;
+        modified.push_back(i);
+        P[i] = S[pos];
+    }
+}
+
+/*
+ * Writes the position of each record in the first word of its payload, so
+ * that the check of the results tells apart the records with equal keys
+ * (an element duplicated or lost by an exchange of equal keys). The other
+ * types are left as they are
+ */
+template<typename T>
+void tag_positions(vector<T> &) {}
+
+template<int Words>
+void tag_positions(vector<BasicRecord<Words>> &P) {
+    for(size_t i=0; i<P.size(); i++) P[i].payload[0] = i;
+}
+
+/*
+ * True if v[lo, hi) holds the elements of ref[lo, hi), a sorted copy of the
+ * problem: the keys must be the same, the elements with equal keys can be in
+ * any order (compared as bytes)
+ */
+template<typename V, typename T, typename Compare>
+bool same_sorted(const V &v, const vector<T> &ref, size_t lo, size_t hi, Compare comp) {
+    auto bytes_less = [] (const T &a, const T &b) { return memcmp(&a, &b, sizeof(T)) < 0; };
+    for(size_t i=lo; i<hi; ) {
+        size_t j = i+1;
+        while(j < hi && !comp(ref[i], ref[j])) j++;
+        for(size_t k=i; k<j; k++)
+            if(comp(v[k], ref[i]) || comp(ref[i], v[k])) return false;
+        // Run [i, j) of equal keys
+        vector<T> a(v.begin()+i, v.begin()+j), b(ref.begin()+i, ref.begin()+j);
+        sort(a.begin(), a.end(), bytes_less);
+        sort(b.begin(), b.end(), bytes_less);
+        if(memcmp(a.data(), b.data(), (j-i)*sizeof(T)) != 0) return false;
+        i = j;
+    }
+    return true;
+}
+
+/*
+ * True if 'perm' (by odd_even_argsort) is a permutation of 0..n-1 that
+ * sorts 'P'
+ */
+template<typename T, typename Compare>
+bool is_sorting_permutation(const vector<T> &P, const vector<uint32_t> &perm, Compare comp) {
+    if(perm.size() != P.size()) return false;
+    vector<bool> seen(P.size(), false);
+    for(size_t k=0; k<perm.size(); k++) {
+        if(perm[k] >= P.size() || seen[perm[k]]) return false;
+        seen[perm[k]] = true;
+        if(k > 0 && comp(P[perm[k]], P[perm[k-1]])) return false;
+    }
+    return true;
+}
+
+// Statistics of the trials of a configuration
+struct Result {
+    string engine, input, mode;
+    long N;
+    int nw, chunksize, trials;
+    unsigned long iter;
+    double min_t, median_t, p95_t; // msecs
+    double speedup, efficiency;
+    long bytes;                    // -1 => not counted
+};
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    vector<string> engines = split_list(get_option(argc, argv, "-e", HAVE_FF ? "seq,static,dyn,block,ff" : "seq,static,dyn,block"));
+    vector<int> sizes = parse_cpulist(get_option(argc, argv, "-n", "10000,50000"));
+    vector<int> nws = parse_cpulist(get_option(argc, argv, "-w", "1,2,4,8"));
+    vector<int> chunks = parse_cpulist(get_option(argc, argv, "-c", "0"));
+    vector<string> inputs = split_list(get_option(argc, argv, "-i", "random"));
+    vector<string> modes = split_list(get_option(argc, argv, "-k", "elements"));
+    const char *xopts = get_option(argc, argv, "-x", "");
+    const char *seglens = get_option(argc, argv, "-g", "64,4096");
+    int R = max(1, get_option(argc, argv, "-r", 5));
+    int U = max(0, get_option(argc, argv, "-u", 1));
+    int budget = get_option(argc, argv, "-b", 10);
+    const char *format = get_option(argc, argv, "-f", "csv");
+    const char *type = get_option(argc, argv, "-t", "int");
+
+    if(argc > 1 || engines.empty() || sizes.empty() || nws.empty() || chunks.empty() || inputs.empty()) {
+        cout << "Usage: " << argv[0] << " [-e engines] [-n N] [-w nw] [-c C] [-i inputs] [-k modes] "
+             << "[-x \"opts\"] [-g min,max] [-r R] [-u U] [-b secs] [-f csv|json] [-t type]" << endl;
+        cout << "    -e engines : seq, static, dyn, block, ff, pool-static, pool-dyn, pool-block," << endl
+             << "                 lib-static, lib-dyn, lib-block, segments, segments-each, resort, dist, file" << endl
+             << "    -n N       : array sizes" << endl
+             << "    -w nw      : numbers of workers (e.g. 1-16)" << endl
+             << "    -c C       : chunksizes for dyn and ff (0 => adaptive/static)" << endl
+             << "    -i inputs  : random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS, changedK" << endl
+             << "    -k modes   : elements, packed, pairs, stable" << endl
+             << "    -x \"opts\"  : options of the engines (e.g. \"-b tree -k 8 -p compact\")" << endl
+             << "    -g min,max : lengths of the segments" << endl
+             << "    -r R       : trials per configuration" << endl
+             << "    -u U       : warmup runs per configuration" << endl
+             << "    -b secs    : time budget per configuration" << endl
+             << "    -f format  : csv or json" << endl
+             << "    -t type    : element type (int, int64, float, double, record, record64)" << endl;
+        return -1;
+    }
+
+    for(auto &e : engines) {
+        if(e == "ff" && !HAVE_FF) {
+            cout << "The ff engine needs FastFlow (ff/parallel_for.hpp in the include path)" << endl;
+            return -1;
+        }
+        if(e != "seq" && e != "static" && e != "dyn" && e != "block" && e != "ff" &&
+           e != "pool-static" && e != "pool-dyn" && e != "pool-block" &&
+           e != "lib-static" && e != "lib-dyn" && e != "lib-block" && e != "segments" &&
+           e != "segments-each" && e != "resort" && e != "dist" && e != "file") {
+            cout << "Unknown engine " << e << endl;
+            return -1;
+        }
+    }
+    for(auto &in : inputs) {
+        if(in.compare(0, 7, "changed") != 0) {
+            if(!InputGenerator(in.c_str(), 2, 42).valid()) return -1;
+        } else if(in.size() == 7 || strspn(in.c_str()+7, "0123456789") != in.size()-7) {
+            cout << "Unknown input " << in << endl;
+            return -1;
+        }
+    }
+    for(auto &m : modes) {
+        if(m != "elements" && m != "packed" && m != "pairs" && m != "stable") {
+            cout << "Unknown mode " << m << endl;
+            return -1;
+        }
+    }
+    bool json = (strcmp(format, "json") == 0);
+
+    int minlen, maxlen;
+    if(sscanf(seglens, "%d,%d", &minlen, &maxlen) != 2 || minlen < 1 || maxlen < minlen) {
+        cout << "The lengths of the segments must be min,max with 1 <= min <= max" << endl;
+        return -1;
+    }
+    bool segmented = any_of(engines.begin(), engines.end(), [] (const string &e) {
+        return e.compare(0, 8, "segments") == 0;
+    });
+
+    /*
+     * Options of the engines: each one parses its own copy of the tokens of
+     * -x, a token that none of them reads is an error
+     */
+    vector<string> xtok;
+    {
+        istringstream in(xopts);
+        for(string tok; in >> tok; ) xtok.push_back(tok);
+    }
+    vector<vector<string>> rest; // Tokens left by each engine
+    auto parse_engine = [&] (auto &opt) {
+        vector<const char *> xargv = { argv[0] };
+        for(auto &tok : xtok) xargv.push_back(tok.c_str());
+        int xargc = xargv.size();
+        opt.parse(xargc, xargv.data());
+        rest.emplace_back(xargv.begin()+1, xargv.begin()+xargc);
+        opt.report = false;
+    };
+    seq_options seq_opt;
+    static_options static_opt;
+    dyn_options dyn_opt;
+    parse_engine(seq_opt);
+    parse_engine(static_opt);
+    parse_engine(dyn_opt);
+    dist_options dist_opt;
+    parse_engine(dist_opt);
+    file_options file_opt;
+    parse_engine(file_opt);
+#if HAVE_FF
+    ff_options ff_opt;
+    parse_engine(ff_opt);
+#endif
+    for(auto &tok : xtok) {
+        bool unknown = all_of(rest.begin(), rest.end(), [&] (const vector<string> &r) {
+            return find(r.begin(), r.end(), tok) != r.end();
+        });
+        if(unknown) {
+            cout << "Unknown engine option " << tok << endl;
+            return -1;
+        }
+    }
+
+    vector<Result> results;
+    string file_path = "odd-even-bench." + to_string(getpid()) + ".tmp"; // Of the file engine
+
+    // Prints a result as soon as it is available
+    auto print_result = [&] (const Result &r) {
+        if(json) {
+            cout << (results.size() == 1 ? "[\n" : ",\n")
+                 << "  {\"engine\": \"" << r.engine << "\", \"type\": \"" << type
+                 << "\", \"N\": " << r.N << ", \"input\": \"" << r.input
+                 << "\", \"mode\": \"" << r.mode << "\", \"nw\": " << r.nw << ", \"chunksize\": " << r.chunksize
+                 << ", \"trials\": " << r.trials << ", \"iterations\": " << r.iter
+                 << ", \"min_ms\": " << r.min_t << ", \"median_ms\": " << r.median_t
+                 << ", \"p95_ms\": " << r.p95_t << ", \"speedup\": " << r.speedup
+                 << ", \"efficiency\": " << r.efficiency << ", \"bytes_moved\": "
+                 << ((r.bytes < 0) ? string("null") : to_string(r.bytes)) << "}";
+        } else {
+            if(results.size() == 1)
+                cout << "engine,type,N,input,mode,nw,chunksize,trials,iterations,"
+                     << "min_ms,median_ms,p95_ms,speedup,efficiency,bytes_moved" << endl;
+            cout << r.engine << "," << type << "," << r.N << "," << r.input << "," << r.mode << ","
+                 << r.nw << "," << r.chunksize << "," << r.trials << "," << r.iter << ","
+                 << r.min_t << "," << r.median_t << "," << r.p95_t << ","
+                 << r.speedup << "," << r.efficiency << ",";
+            if(r.bytes >= 0) cout << r.bytes;
+            cout << endl;
+        }
+    };
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        for(int N : sizes) {
+            for(auto &input : inputs) {
+                vector<T> P(max(N, 0)), A(max(N, 0));
+                vector<size_t> modified; // Changed positions of a changedK input
+                if(input.compare(0, 7, "changed") == 0) changed_input(P, atol(input.c_str()+7), modified);
+                else generate_input(P, input.c_str(), 42);
+                tag_positions(P);
+                unsigned long inv = count_inversions(P, Compare());
+                vector<size_t> offsets = segment_offsets(N, minlen, maxlen); // Of the segments engines
+
+                // Sorted copies of the problem, whole and by segments, to check the results
+                vector<T> S = P, SS = P;
+                stable_sort(S.begin(), S.end(), Compare());
+                if(segmented)
+                    for(size_t s=0; s+1<offsets.size(); s++)
+                        stable_sort(SS.begin()+offsets[s], SS.begin()+offsets[s+1], Compare());
+
+                for(auto &mode : modes) {
+                    bool elements = (mode == "elements");
+                    key_mode km = (mode == "pairs") ? key_pairs : (mode == "stable") ? key_stable : key_packed;
+
+                    // Sorts 'v' in the current mode, on 'pool' or with new threads (null)
+                    auto sort_mode = [&] (WorkerPool *pool, vector<T> &v, auto policy) {
+                        if(pool) {
+                            if(elements)
+                                return odd_even_sort(*pool, v.begin(), v.end(), policy, Compare());
+                            return odd_even_sort_by_key(*pool, v.begin(), v.end(), policy, Compare(), km);
+                        }
+                        if(elements)
+                            return odd_even_sort(v.begin(), v.end(), policy, Compare());
+                        return odd_even_sort_by_key(v.begin(), v.end(), policy, Compare(), km);
+                    };
+
+                    /*
+                     * Bytes written by the element-wise engines: the sorted words
+                     * (2 per inversion), plus, by key, the words built from the
+                     * elements, the positions and the elements moved to a buffer
+                     * and back
+                     */
+                    auto bytes_moved = [&] (const string &engine) -> long {
+                        if(engine == "block" || engine == "pool-block" || engine == "lib-block") return -1;
+                        if(engine == "dist" || engine == "file") return -1;
+                        if(engine.compare(0, 8, "segments") == 0) return -1;
+                        if(elements) return 2*inv*sizeof(T);
+
+                        using Key = decay_t<decltype(comparator_key<Compare>::get(P[0]))>;
+                        long word = (mode == "packed" && is_packable_key<Key>) ? 8 : sizeof(KeyIndex<Key>);
+                        return (2*inv + N)*word + (long)N*sizeof(uint32_t) + 2L*N*sizeof(T);
+                    };
+
+                    double seq_median = 0, seg_median = 0;
+
+                    /*
+                     * Runs the warmup and the trials of 'sort_fn(v)', after
+                     * 'refill(v)' writes the problem in 'v' (not measured), and
+                     * records the result. Returns false if the engine failed
+                     */
+                    auto bench = [&] (const string &engine, int nw, int chunksize, auto &v, auto refill, auto sort_fn) {
+                        vector<double> times;
+                        long iter = 0;
+                        auto begin = high_resolution_clock::now();
+
+                        for(int i=0; i<U+R; i++) {
+                            refill(v);
+
+                            auto start = high_resolution_clock::now();
+                            iter = sort_fn(v);
+                            auto stop = high_resolution_clock::now();
+
+                            if(iter < 0) return false;
+                            // The file engine checks the file itself
+                            bool segments = (engine.compare(0, 8, "segments") == 0);
+                            if(engine != "file" && !same_sorted(v, segments ? SS : S, 0, N, Compare())) {
+                                cout << "Wrong result of " << engine << " (" << input << ", N = " << N
+                                     << ", nw = " << nw << ", mode " << mode << ")" << endl;
+                                return false;
+                            }
+                            if(i >= U) times.push_back(duration_cast<nanoseconds>(stop - start).count()/1e6);
+                            if(!times.empty() && duration_cast<seconds>(stop - begin).count() >= budget) break;
+                        }
+
+                        sort(times.begin(), times.end());
+                        int n = times.size();
+
+                        Result r;
+                        r.engine = engine; r.input = input; r.mode = mode; r.N = N;
+                        r.nw = nw; r.chunksize = chunksize; r.trials = n; r.iter = iter;
+                        r.min_t = times[0];
+                        r.median_t = (n % 2) ? times[n/2] : (times[n/2-1] + times[n/2])/2;
+                        r.p95_t = times[max(0, (95*n + 99)/100 - 1)];
+                        if(engine == "seq") seq_median = r.median_t;
+                        if(engine == "segments-seq") seg_median = r.median_t;
+                        r.speedup = ((engine.compare(0, 8, "segments") == 0) ? seg_median : seq_median)/r.median_t;
+                        r.efficiency = r.speedup/nw;
+                        r.bytes = bytes_moved(engine);
+
+                        results.push_back(r);
+                        print_result(r);
+                        return true;
+                    };
+
+                    // Copy of the problem, by the thread that runs the engine
+                    auto copy_problem = [&] (vector<T> &v) { copy(P.begin(), P.end(), v.begin()); };
+
+                    // The sequential version in the same mode is the baseline of the others
+                    WorkerPool seq_pool(1);
+                    if(!bench("seq", 1, 0, A, copy_problem, [&] (vector<T> &v) -> long {
+                        if(elements) return odd_even_seq<T, Compare>(v, seq_opt);
+                        return sort_mode(&seq_pool, v, sequential_policy{});
+                    })) return -1;
+                    if(segmented && elements &&
+                       !bench("segments-seq", 1, 0, A, copy_problem, [&] (vector<T> &v) -> long {
+                           return odd_even_sort_segments(seq_pool, v.data(), offsets, sequential_policy{}, 1 << 14, Compare());
+                       })) return -1;
+
+                    for(int nw : nws) {
+                        if(nw < 1) continue;
+                        WorkerPool pool(nw);
+
+                        // Vector placed by the workers of an engine, and copy of the
+                        // problem by the same workers (see first_touch_fill)
+                        using placed_vector = vector<T, default_init_allocator<T>>;
+                        auto placed_copy = [&] (const vector<int> &cpus, auto part) {
+                            return [&, cpus, part] (placed_vector &v) {
+                                first_touch_fill(v, [&] (int i) { return P[i]; }, nw, cpus, part);
+                            };
+                        };
+
+                        for(auto &engine : engines) {
+                            bool ok = true;
+
+                            // The engines of the executables sort the elements themselves
+                            if(engine == "static" && elements) {
+                                vector<int> cpus;
+                                if(!pin_plan(static_opt.pinning, nw, cpus)) return -1;
+                                placed_vector B(N);
+                                ok = bench(engine, nw, 0, B, placed_copy(cpus, [N, nw] (int t, int *lo, int *hi) {
+                                    even_partition(N, nw, t, lo, hi);
+                                }), [&] (placed_vector &v) {
+                                    return odd_even_par_static<T, Compare>(v, nw, static_opt);
+                                });
+                            } else if(engine == "dyn" && elements) {
+                                DynPlacement place;
+                                if(!place.plan(dyn_opt.pinning, N, nw)) return -1;
+                                placed_vector B(N);
+                                for(int c : chunks) {
+                                    ok = ok && bench(engine, nw, c, B, placed_copy(place.cpus, [place] (int t, int *lo, int *hi) {
+                                        place.part(t, lo, hi);
+                                    }), [&] (placed_vector &v) {
+                                        return odd_even_par_dyn<T, Compare>(v, nw, c, dyn_opt);
+                                    });
+                                }
+                            } else if(engine == "block" && elements) {
+                                ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) {
+                                    return odd_even_par_block<T, Compare>(v, nw, false);
+                                });
+                            } else if(engine == "dist" && elements) {
+                                ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) {
+                                    return odd_even_dist<T, Compare>(v, nw, dist_opt);
+                                });
+                            } else if(engine == "file" && elements) {
+                                // The engine checks the file, nothing is left in memory
+                                vector<T> none;
+                                ok = bench(engine, nw, 0, none, [&] (vector<T> &) {
+                                    ofstream out(file_path, ios::binary | ios::trunc);
+                                    out.write((const char *)P.data(), P.size()*sizeof(T));
+                                }, [&] (vector<T> &) {
+                                    return odd_even_file<T, Compare>(file_path.c_str(), nw, file_opt);
+                                });
+                            } else if(engine == "ff" && elements) {
+#if HAVE_FF
+                                for(int c : chunks) {
+                                    ok = ok && bench(engine, nw, c, A, copy_problem, [&] (vector<T> &v) {
+                                        return odd_even_ff<T, Compare>(v, nw, c, ff_opt);
+                                    });
+                                }
+#endif
+                            } else if(engine.compare(0, 5, "pool-") == 0 || engine.compare(0, 4, "lib-") == 0) {
+                                // The library on the pool, or creating the threads at each sort
+                                WorkerPool *team = (engine[0] == 'p') ? &pool : nullptr;
+                                string policy = engine.substr(engine.find('-') + 1);
+
+                                // By key, the permutation of odd_even_argsort is checked too
+                                auto check_argsort = [&] (auto p) {
+                                    if(elements) return true;
+                                    vector<uint32_t> perm;
+                                    odd_even_argsort(pool, P.data(), N, perm, p, Compare(), km);
+                                    if(is_sorting_permutation(P, perm, Compare())) return true;
+                                    cout << "Wrong permutation of argsort (" << policy << ", " << input
+                                         << ", N = " << N << ", nw = " << nw << ", mode " << mode << ")" << endl;
+                                    return false;
+                                };
+                                if(policy == "static") {
+                                    ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) -> long {
+                                        return sort_mode(team, v, static_policy{nw});
+                                    }) && check_argsort(static_policy{nw});
+                                } else if(policy == "dyn") {
+                                    for(int c : chunks) {
+                                        ok = ok && bench(engine, nw, c, A, copy_problem, [&] (vector<T> &v) -> long {
+                                            return sort_mode(team, v, dynamic_policy{nw, c});
+                                        }) && check_argsort(dynamic_policy{nw, c});
+                                    }
+                                } else {
+                                    ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) -> long {
+                                        return sort_mode(team, v, block_policy{nw});
+                                    }) && check_argsort(block_policy{nw});
+                                }
+                            } else if(engine == "segments" && elements) {
+                                ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) -> long {
+                                    return odd_even_sort_segments(pool, v.data(), offsets, static_policy{nw}, 1 << 14, Compare());
+                                });
+                            } else if(engine == "segments-each" && elements) {
+                                ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) {
+                                    long iter = 0;
+                                    for(size_t s=0; s+1<offsets.size(); s++)
+                                        iter += odd_even_sort(pool, v.data()+offsets[s], offsets[s+1]-offsets[s], static_policy{nw}, Compare());
+                                    return iter;
+                                });
+                            } else if(engine == "resort" && elements && input.compare(0, 7, "changed") == 0) {
+                                // Iterations, from the phases of the windows
+                                ok = bench(engine, nw, 0, A, copy_problem, [&] (vector<T> &v) -> long {
+                                    return (odd_even_resort(pool, v.data(), N, modified, static_policy{nw}, Compare()).phases + 1)/2;
+                                });
+                            }
+                            if(!ok) return -1;
+                        }
+                    }
+                }
+            }
+        }
+
+        if(json && !results.empty()) cout << "\n]" << endl;
+        return 0;
+    };
+
+    int ret = dispatch_type(type, run);
+    unlink(file_path.c_str());
+    return ret;
+}
@@ -0,0 +1,80 @@
+/*
+ * ---- odd-even-dist.cpp
+ *
+ * Distributed version of the block Odd-even Sort (merge-split): the array
+ * is split among np ranks (processes), each one owning a partition like a
+ * worker of odd-even-par-block, and the ranks only communicate through a
+ * Transport (see Transport.cpp). Each rank generates its own part of the
+ * problem (the counter-based generators give the same array for any np)
+ * and sorts it locally, then in each round a couple of neighbours merges
+ * the two partitions, the left one keeping the smallest elements and the
+ * right one the largest. Only the boundary blocks are exchanged: the
+ * neighbours first swap their extreme elements, then the left one sends
+ * its elements larger than the minimum of the right one, and the right one
+ * its elements smaller than the maximum of the left one. The termination
+ * is a global OR reduction at the end of each iteration (even and odd
+ * round). The ranks are started as local processes.
+ * The sort itself is odd_even_dist_ranks (Include/DistEngine.cpp), also run
+ * by odd-even-bench.
+ * Takes 3 arguments:
+ *      N    : number of array elements
+ *      seed : seed for the problem generation
+ *      np   : number of ranks
+ * and the options:
+ *      -x transport : shm (shared memory, default) or unix (Unix sockets)
+ *      -i dist      : input distribution (see Generators.cpp, default random)
+ *      -c bytes     : capacity of each shared memory channel (default 1M)
+ *      -t type      : element type (int, int64, float, double, record, record64)
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-dist.cpp -o odd-even-dist
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "utils.cpp"
+#include "Generators.cpp"
+#include "DistEngine.cpp"
+
+using namespace std;
+
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *input = get_option(argc, argv, "-i", "random");
+    dist_options opt;
+    opt.parse(argc, argv);
+
+    if(argc < 4) {
+        cout << "Usage: " << argv[0] << " N seed np [-x transport] [-i dist] [-c bytes] [-t type]" << endl;
+        cout << "    N    : number of array elements" << endl
+             << "    seed : seed for the problem generation" << endl
+             << "    np   : number of ranks (processes)" << endl
+             << "    -x transport : shm or unix" << endl
+             << "    -i dist      : input distribution (random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS)" << endl
+             << "    -c bytes     : capacity of each shared memory channel" << endl
+             << "    -t type      : element type (int, int64, float, double, record, record64)" << endl;
+        return -1;
+    }
+
+    // Command line arguments
+    long N   = max(2, atoi(argv[1]));
+    int seed = atoi(argv[2]);
+    int np   = atoi(argv[3]);
+
+    InputGenerator gen(input, N, seed);
+    if(!gen.valid()) return -1;
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+        return (odd_even_dist_ranks<T, Compare>(N, gen, (T *)nullptr, np, opt) < 0) ? -1 : 0;
+    };
+
+    return dispatch_type(type, run);
+}
@@ -2,12 +2,24 @@
  * ---- odd-even-ff.cpp
  *
  * Odd-even Sort using FastFlow library
+ * The sort itself is odd_even_ff (Include/FFEngine.cpp), also run
+ * in-process by odd-even-bench and calibrated by odd-even-tune.
  * Takes 4 or 5 arguments:
  *      N         : number of array elements
  *      niter     : upper bound for the number of iterations (optional)
  *      seed      : seed for the problem generation
- *      nw        : number of workers
- *      chunksize : size of a single computation
+ *      nw        : number of workers (auto => from the machine profile)
+ *      chunksize : size of a single computation (auto => from the machine
+ *                  profile, see odd-even-tune.cpp)
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -i dist : input distribution, generated in parallel and the same for
+ *              any number of threads: random, sorted, reversed, iterK,
+ *              nearlyK, fewK, sawtoothK, organ or zipfS (see Generators.cpp);
+ *              the seed is the one of the generator and niter is ignored
+ *      -a C      : active region tracking, the loop runs over chunks of C
+ *                  elements, skipping the ones that (and whose neighbours)
+ *                  did not change in the previous phase
  *
  * Compile with
  * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-ff.cpp -o odd-even-ff
@@ -19,35 +31,37 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <numeric>
-#include <chrono>
-#include <random>
-#include <thread>
-#include <atomic>
-
-#include <ff/ff.hpp>
-#include <ff/parallel_for.hpp>
+#include <cassert>
+#include <cstring>
 
 #include "utils.cpp"
-#include "Timer.cpp"
+#include "Generators.cpp"
+#include "Profile.cpp"
+#include "FFEngine.cpp"
 
 using namespace std;
-using namespace std::chrono;
-using namespace ff;
-
 
 int main(int argc, char const *argv[])
 {
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *input = get_option(argc, argv, "-i", (const char *)nullptr);
+    ff_options opt;
+    opt.parse(argc, argv);
+
     if(argc < 5) {
-        cout << "Usage: " << argv[0] << " N [niter] seed nw chunksize" << endl;
+        cout << "Usage: " << argv[0] << " N [niter] seed nw chunksize [-a C] [-t type] [-i dist]" << endl;
         cout << "    N     : number of array elements" << endl
              << "    niter : number of iterations (optional)" << endl
              << "    seed  : seed for the random number generator (-1 => reversed vector)" << endl
-             << "    nw    : number of workers" << endl
-             << "    chunksize : size of a single computation" << endl
+             << "    nw    : number of workers (auto => from the machine profile)" << endl
+             << "    chunksize : size of a single computation (auto => from the machine profile)" << endl
              << "                (=0 : static block scheduling)" << endl
              << "                (<0 : static cyclic scheduling)" << endl
-             << "                (>0 : auto-scheduling)" << endl;
+             << "                (>0 : auto-scheduling)" << endl
+             << "    -a C  : skip the chunks of C elements that cannot change (0 => disabled)" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl
+             << "    -i dist : input distribution (random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS)" << endl;
         return -1;
     }
 
@@ -58,93 +72,32 @@ int main(int argc, char const *argv[])
     int nw    = (argc >= 6) ? atoi(argv[4]) : atoi(argv[3]);
     int chunksize = (argc >= 6) ? atoi(argv[5]) : atoi(argv[4]);
 
-    // Statistics
-    unsigned long iter = 0;
-#if STATS
-    unsigned long even_time = 0, odd_time = 0;
-    unsigned long temp;
-#endif
-
-    // Vector to be sorted
-    vector<int> A(N);
-    if(seed == -1) fill_reversed(A);
-    else if(niter == 0) fill_random(A, seed);
-    else fill_for_fixed_iterations(A, seed, niter);
-#if PRINT
-    cout << "INIT  ";
-    print_vector(A);
-#endif
-
-    // Variable for the stopping condition
-    int swapped = 1;
-
-    auto body = [&] (const long i, int &s) {
-        if(A[i] > A[i+1]) {
-            swap(A[i], A[i+1]);
-            s = 1;
-        }
-    };
-
-    auto reduce = [&] (int &s, const int e) { s |= e; };
-
-    ParallelForReduce<int> pfr(nw, true);
-    pfr.disableScheduler();
-
-    ffTime(START_TIME);
+    // "auto" takes the value from the machine profile written by odd-even-tune
+    bool auto_nw    = strcmp((argc >= 6) ? argv[4] : argv[3], "auto") == 0;
+    bool auto_chunk = strcmp((argc >= 6) ? argv[5] : argv[4], "auto") == 0;
+    profile_settings(type, N, auto_nw, auto_chunk, true, &nw, &chunksize);
 
-    int even_end = (N%2 == 0) ? N : N-1;
-    int odd_end = (N%2 == 0) ? N-1 : N;
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
 
-    while(swapped) {
-        iter++;
-        swapped = 0;
-
-        // Even phase
-#if STATS
-        {   Timer t_even(&temp);
-#endif
-            pfr.parallel_reduce(
-                    swapped, 0,
-                    0, even_end, 2, chunksize,
-                    body, reduce, nw);
-#if STATS
-        }   even_time += temp;
-#endif
+        // Vector to be sorted
+        vector<T> A(N);
+        if(!input) fill_problem(A, seed, niter, nw);
+        else if(!generate_input(A, input, seed, nw)) return -1;
 #if PRINT
-        cout << "EVEN  ";
+        cout << "INIT  ";
         print_vector(A);
 #endif
 
-        // Odd phase
-#if STATS
-        {   Timer t_odd(&temp);
-#endif
-            pfr.parallel_reduce(
-                    swapped, 0,
-                    1, odd_end, 2, chunksize,
-                    body, reduce, nw);
-#if STATS
-        }   odd_time += temp;
-#endif
-#if PRINT
-        cout << "ODD   ";
-        print_vector(A);
-#endif
-    }
-
-    ffTime(STOP_TIME);
-    auto total_time = ffTime(GET_TIME);
+        odd_even_ff<T, Compare>(A, nw, chunksize, opt);
 
+        // Just to make sure it works for larger vectors
+        assert(is_sorted(A.begin(), A.end(), Compare()));
 
-    cout << "Total time with " << nw << " workers: " << ((float)total_time) << " msecs" << endl;
-    cout << "Iterations: " << iter << " (" << ((float)total_time)/iter*1000 << " usecs per iteration)" << endl;
-#if STATS
-    cout << "Avg even phase  " << ((float)even_time)/iter/1000 << " usecs" << endl
-         << "Avg odd phase   " << ((float)odd_time)/iter/1000 << " usecs" << endl;
-#endif
-
-    // Just to make sure it works for larger vectors
-    assert(is_sorted(A.begin(), A.end()));
+        return 0;
+    };
 
-    return 0;
+    return dispatch_type(type, run);
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+/*
+ * ---- odd-even-file.cpp
+ *
+ * Block Odd-even Sort (merge-split) of a binary file, possibly larger than
+ * the memory, sorted in place on a shared memory mapping of the file.
+ * The file is divided in blocks of B elements (B elements of two blocks
+ * must fit in memory): each block is sorted locally, then the blocks are
+ * exchanged with odd-even transposition, the couples of adjacent blocks of
+ * a round being merged by the workers. Each round is a sequential pass on
+ * the file, and at most nb rounds are needed for nb blocks.
+ * The sort itself is odd_even_file (Include/FileEngine.cpp), also run by
+ * odd-even-bench.
+ * Takes 2 arguments:
+ *      file  : binary file of elements of the given type (native endianness)
+ *      nw    : number of workers
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -B B    : elements per block (0 => N/nw, at most 16M)
+ *      -g N    : first write N random elements to the file
+ *      -r seed : seed for -g (-1 => reversed vector)
+ *      -i dist : distribution for -g (see Generators.cpp, default random);
+ *                the file is written in chunks without holding the whole
+ *                problem in memory
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-file.cpp -o odd-even-file
+ *
+ * Compile with -DSTATS to print extended statistics (for each thread) at the end
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include "utils.cpp"
+#include "Generators.cpp"
+#include "FileEngine.cpp"
+
+using namespace std;
+
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    file_options opt;
+    opt.parse(argc, argv);
+    long gen = get_option(argc, argv, "-g", 0);
+    int seed = get_option(argc, argv, "-r", 42);
+    const char *input = get_option(argc, argv, "-i", (const char *)nullptr);
+
+    if(argc < 3) {
+        cout << "Usage: " << argv[0] << " file nw [-t type] [-B B] [-g N] [-r seed] [-i dist]" << endl;
+        cout << "    file  : binary file to be sorted in place" << endl
+             << "    nw    : number of workers" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl
+             << "    -B B    : elements per block (0 => N/nw, at most 16M)" << endl
+             << "    -g N    : write N random elements to the file first" << endl
+             << "    -r seed : seed for -g (-1 => reversed vector)" << endl
+             << "    -i dist : distribution for -g (random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS)" << endl;
+        return -1;
+    }
+
+    // Command line arguments
+    const char *path = argv[1];
+    int nw = max(1, atoi(argv[2]));
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        // Problem generation, in chunks without holding the whole problem in memory
+        if(gen > 0) {
+            InputGenerator g((input) ? input : problem_input(seed, 0).c_str(), gen, seed);
+            if(!g.valid()) return -1;
+            ofstream out(path, ios::binary | ios::trunc);
+            vector<T> P(min(gen, 1L << 20));
+            for(long lo=0; lo<gen && out; lo+=P.size()) {
+                long n = min((long)P.size(), gen-lo);
+                for(long i=0; i<n; i++) P[i] = T(g(lo+i));
+                out.write((const char *)P.data(), n*sizeof(T));
+            }
+            if(!out) {
+                cout << "Cannot write " << path << endl;
+                return -1;
+            }
+        }
+
+        return (odd_even_file<T, Compare>(path, nw, opt) < 0) ? -1 : 0;
+    };
+
+    return dispatch_type(type, run);
+}
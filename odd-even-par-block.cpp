@@ -0,0 +1,93 @@
+/*
+ * ---- odd-even-par-block.cpp
+ *
+ * Parallel version of the block Odd-even Sort (merge-split) using pthread
+ * with static division of the work.
+ * Each worker sorts its block locally, then the blocks are exchanged with
+ * odd-even transposition: in each round a couple of adjacent workers merges
+ * the two blocks, the left one keeping the smallest elements and the right
+ * one the largest. At most nw rounds are needed.
+ * Uses atomic variables and active barriers for thread synchronization.
+ * The sort itself is odd_even_par_block (Include/BlockEngine.cpp), also run
+ * in-process by odd-even-bench.
+ * Takes 3 or 4 arguments:
+ *      N     : number of array elements
+ *      niter : upper bound for the number of iterations (optional)
+ *      seed  : seed for the problem generation
+ *      nw    : number of workers
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -i dist : input distribution, generated in parallel and the same for
+ *              any number of threads: random, sorted, reversed, iterK,
+ *              nearlyK, fewK, sawtoothK, organ or zipfS (see Generators.cpp);
+ *              the seed is the one of the generator and niter is ignored
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-par-block.cpp -o odd-even-par-block
+ *
+ * Compile with -DPRINT to display the vector after every iteration
+ * Compile with -DSTATS to print extended statistics (for each thread) at the end
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "utils.cpp"
+#include "Generators.cpp"
+#include "BlockEngine.cpp"
+
+using namespace std;
+
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *input = get_option(argc, argv, "-i", (const char *)nullptr);
+
+    if(argc < 4) {
+        cout << "Usage: " << argv[0] << " N [niter] seed nw [-t type] [-i dist]" << endl;
+        cout << "    N     : number of array elements" << endl
+             << "    niter : number of iterations (optional)" << endl
+             << "    seed  : seed for the random number generator (-1 => reversed vector)" << endl
+             << "    nw    : number of workers" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl
+             << "    -i dist : input distribution (random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS)" << endl;
+        return -1;
+    }
+
+    // Command line arguments
+    int N     = atoi(argv[1]);
+    int niter = (argc >= 5) ? atoi(argv[2]) : 0;
+    int seed  = (argc >= 5) ? atoi(argv[3]) : atoi(argv[2]);
+    int nw    = (argc >= 5) ? atoi(argv[4]) : atoi(argv[3]);
+
+    // An empty block would separate its neighbours forever
+    nw = max(1, min(nw, N/2));
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        // Vector to be sorted
+        vector<T> A(N);
+        if(!input) fill_problem(A, seed, niter, nw);
+        else if(!generate_input(A, input, seed, nw)) return -1;
+#if PRINT
+        cout << "INIT  ";
+        print_vector(A);
+#endif
+
+        odd_even_par_block<T, Compare>(A, nw);
+
+        // Just to make sure it works for larger vectors
+        assert(is_sorted(A.begin(), A.end(), Compare()));
+
+        return 0;
+    };
+
+    return dispatch_type(type, run);
+}
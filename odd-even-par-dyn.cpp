@@ -3,13 +3,45 @@
  *
  * Parallel version of the Odd-even Sort using pthread with
  * auto scheduling for the work division.
- * Uses atomic variables and active barriers for thread synchronization.
+ * Uses atomic variables and active (or hybrid) barriers for thread synchronization,
+ * or a tree barrier that also computes the termination condition. Without a
+ * master thread (-d) main is one of the workers.
+ * The sort itself is odd_even_par_dyn (Include/DynEngine.cpp), also run
+ * in-process by odd-even-bench and calibrated by odd-even-tune.
  * Takes 4 or 5 arguments:
  *      N         : number of array elements
  *      niter     : upper bound for the number of iterations (optional)
  *      seed      : seed for the problem generation
- *      nw        : number of workers
- *      chunksize : size of a single computation
+ *      nw        : number of workers (auto => from the machine profile)
+ *      chunksize : size of a single computation (0 => adaptive, chosen
+ *                  at each iteration by the TaskManager, auto => from the
+ *                  machine profile, see odd-even-tune.cpp)
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -i dist : input distribution, generated in parallel and the same for
+ *              any number of threads: random, sorted, reversed, iterK,
+ *              nearlyK, fewK, sawtoothK, organ or zipfS (see Generators.cpp);
+ *              the seed is the one of the generator and niter is ignored
+ *      -b barrier : active (busy waiting), hybrid (spin with pause and
+ *              backoff, then sleep on a futex) or tree (combining tree, the
+ *              workers reduce the swaps at the barrier, without the master)
+ *      -s S  : pauses before sleeping for the hybrid barrier
+ *      -p policy : thread pinning, none, compact (fill a NUMA node first),
+ *              scatter (round robin on the nodes) or a list of CPUs; the
+ *              array is split among the nodes, each worker initializes a
+ *              part of the range of its node and takes its tasks from it
+ *      -d    : decentralized termination, main is one of the workers and the
+ *              last worker to arrive at a barrier resets it (implied by -b tree)
+ *      -a C      : active region tracking, only the chunks of C elements
+ *                  that (or whose neighbours) changed in the previous phase
+ *                  are handed out by the TaskManager
+ *      -T file   : trace the phases, the tasks and the barriers of each
+ *                  worker, written to 'file' at the end in the Chrome trace format
+ *      -K kernel : version of sort_couples, default (widest vectorized one),
+ *                  scalar, branchless, simd, run (chosen once by calibration
+ *                  and the initial swaps) or phase (chosen by each worker at
+ *                  each phase from the swaps of its tasks); prints which
+ *                  kernel ran when
  *
  * Compile with
  * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-par-dyn.cpp -o odd-even-par-dyn
@@ -21,32 +53,42 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <chrono>
-#include <atomic>
 #include <cassert>
-#include <mutex>
-#include <thread>
+#include <cstring>
 
-#include "business_logic.cpp"
 #include "utils.cpp"
-#include "ActiveBarrier.cpp"
-#include "TaskManager.cpp"
-#include "Timer.cpp"
+#include "Generators.cpp"
+#include "Profile.cpp"
+#include "Affinity.cpp"
+#include "DynEngine.cpp"
 
 using namespace std;
-using namespace std::chrono;
 
 
 int main(int argc, char const *argv[])
 {
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *input = get_option(argc, argv, "-i", (const char *)nullptr);
+    dyn_options opt;
+    opt.parse(argc, argv);
+
     if(argc < 5) {
-        cout << "Usage: " << argv[0] << " N [niter] seed nw chunksize" << endl;
+        cout << "Usage: " << argv[0] << " N [niter] seed nw chunksize [-a C] [-t type] [-i dist] [-b barrier] [-s S] [-p policy] [-d] [-T file] [-K kernel]" << endl;
         cout << "    N     : number of array elements" << endl
              << "    niter : number of iterations (optional)" << endl
              << "    seed  : seed for the random number generator (-1 => reversed vector)" << endl
-             << "    nw    : number of workers" << endl
-             << "    chunksize : size of a single computation (0 => chunksize = N/nw)" << endl;
-        return -1;
+             << "    nw    : number of workers (auto => from the machine profile)" << endl
+             << "    chunksize : size of a single computation (0 => adaptive, auto => from the machine profile)" << endl
+             << "    -a C  : hand out only the chunks of C elements that can change (0 => disabled)" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl
+             << "    -i dist : input distribution (random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS)" << endl
+             << "    -b barrier : active (busy waiting), hybrid (spin, then sleep) or tree" << endl
+             << "    -s S  : pauses before sleeping with -b hybrid (<0 => never sleep)" << endl
+             << "    -p policy : pinning, none, compact, scatter or a list of CPUs (e.g. 0,2,4-7)" << endl
+             << "    -d    : no master thread, the workers check the termination" << endl
+             << "    -T file : write a Chrome trace of the phases, tasks and barriers to file" << endl
+             << "    -K kernel : default, scalar, branchless, simd, run or phase (auto-selection)" << endl;
         return -1;
     }
 
@@ -56,196 +98,40 @@ int main(int argc, char const *argv[])
     int seed  = (argc >= 6) ? atoi(argv[3]) : atoi(argv[2]);
     int nw    = (argc >= 6) ? atoi(argv[4]) : atoi(argv[3]);
     int chunksize = (argc >= 6) ? atoi(argv[5]) : atoi(argv[4]);
-    if(chunksize <= 0) chunksize = N/nw;
 
-
-    // Statistics
-    unsigned long iter = 0;
-#if STATS
-    mutex print_m; // For mutual exclusive prints
-#endif
-
-    // Vector to be sorted
-    vector<int> A(N);
-    if(seed == -1) fill_reversed(A);
-    else if(niter == 0) fill_random(A, seed);
-    else fill_for_fixed_iterations(A, seed, niter);
+    // "auto" takes the value from the machine profile written by odd-even-tune
+    bool auto_nw    = strcmp((argc >= 6) ? argv[4] : argv[3], "auto") == 0;
+    bool auto_chunk = strcmp((argc >= 6) ? argv[5] : argv[4], "auto") == 0;
+    profile_settings(type, N, auto_nw, auto_chunk, false, &nw, &chunksize);
+
+    // CPU and NUMA node of each worker
+    DynPlacement place;
+    if(!place.plan(opt.pinning, N, nw)) return -1;
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        // Vector to be sorted, generated on the nodes of the workers
+        vector<T, default_init_allocator<T>> A(N);
+        InputGenerator gen((input) ? input : problem_input(seed, niter).c_str(), N, seed);
+        if(!gen.valid()) return -1;
+        first_touch_fill(A, gen, nw, place.cpus, [&] (int t, int *lo, int *hi) {
+            place.part(t, lo, hi);
+        });
 #if PRINT
-    cout << "INIT  ";
-    print_vector(A);
-#endif
-
-
-    auto start = high_resolution_clock::now();
-
-    // Variable for the stopping condition
-    atomic<int> swapped = 0;
-
-    // Variables and structures for synchronization
-    atomic<bool> terminate = false;
-    ActiveBarrier even_barrier(nw), odd_barrier(nw);
-
-    // Shared data structute for auto-scheduling
-    TaskManager tm(chunksize, N);
-    tm.set_index(0);
-
-    auto worker_fun = [&] (int t)
-    {
-#if STATS
-        unsigned long even_time = 0, even_runs = 0,       // Even phase statistics
-                      even_overhead = 0, even_swaps = 0;
-        unsigned long odd_time = 0, odd_runs = 0,         // Odd phase statistics
-                      odd_overhead = 0, odd_swaps = 0;
-        unsigned long barrier1_t = 0, barrier2_t = 0, update_t = 0; // Overhead statistics
-
-        unsigned long temp;
-#endif
-
-        int swapped_prv, nswaps, start, end;
-        while(!terminate) {
-            // Even phase
-            nswaps = 0;
-#if STATS
-            {   Timer t_even(&temp);
-#endif
-                while(tm.get_task(&start, &end)) {
-#if STATS
-                    { Timer t_scan(&temp);
-#endif
-                    nswaps += sort_couples(A, start, end);
-#if STATS
-                    } even_time += temp;
-                    even_runs++;
-#endif
-                }
-                swapped_prv = nswaps;
-#if STATS
-            }   even_overhead += temp;
-                even_swaps += nswaps;
-#endif
-
-            // Barrier, wait for the master thread to reset it
-#if STATS
-            {   Timer t_b1(&temp);
-#endif
-                odd_barrier.wait_reset();
-#if STATS
-            }   barrier1_t += temp;
-#endif
-
-            // Odd phase
-            nswaps = 0;
-#if STATS
-            {   Timer t_odd(&temp);
-#endif
-                while(tm.get_task(&start, &end)) {
-#if STATS
-                    { Timer t_scan(&temp);
-#endif
-                    nswaps += sort_couples(A, start, end);
-#if STATS
-                    } odd_time += temp;
-                    odd_runs++;
-#endif
-                }
-                swapped_prv |= nswaps;
-#if STATS
-            }   odd_overhead += temp;
-                odd_swaps += nswaps;
-#endif
-
-            // Atomicly update the shared variable
-#if STATS
-            {   Timer t_update(&temp);
-#endif
-                swapped |= swapped_prv;
-#if STATS
-            }   update_t += temp;
-#endif
-
-            // Barrier, wait for the master thread (main) to reset the barrier
-#if STATS
-            {   Timer t_b2(&temp);
-#endif
-                even_barrier.wait_reset();
-#if STATS
-            }   barrier2_t += temp;
-#endif    
-        } // End of loop
-
-
-#if STATS
-        {
-            unique_lock<mutex> print_lock(print_m);
-            cout << "Worker " << t << ":" << endl
-                 << "\tAvg even run        " << ((float)even_time)/even_runs/1000 << " usecs ("
-                 << even_swaps/even_runs << " swaps)" << endl
-                 << "\tAvg task retrieve   "
-                 << ((float)even_overhead-even_time)/even_runs/1000 << " usecs" << endl
-                 << "\tAvg even phase      " << ((float)even_time)/iter/1000 << " usecs" << endl
-                 << "\tAvg even scheduling " << ((float)even_overhead-even_time)/iter/1000 << " usecs" << endl
-                 << "\tAvg barrier 1       " << ((float)barrier1_t)/iter/1000 << " usecs" << endl
-                 << "\tAvg odd run         " << ((float)odd_time)/odd_runs/1000 << " usecs ("
-                 << odd_swaps/odd_runs << " swaps)" << endl
-                 << "\tAvg task retrieve   "
-                 << ((float)odd_overhead-odd_time)/odd_runs/1000 << " usecs" << endl
-                 << "\tAvg odd phase       " << ((float)odd_time)/iter/1000 << " usecs" << endl
-                 << "\tAvg odd scheduling  " << ((float)odd_overhead-odd_time)/iter/1000 << " usecs" << endl
-                 << "\tAvg update          " << ((float)update_t)/iter/1000 << " usecs" << endl
-                 << "\tAvg barrier 2       " << ((float)barrier2_t)/iter/1000 << " usecs" << endl << endl;
-        }
-#endif
-
-        return;
-    };
-
-    // Start the workers
-    vector<thread*> workers(nw);
-    for(int i=0; i<nw; i++)
-        workers[i] = new thread(worker_fun, i);
-
-    while(true) {
-        iter++;
-
-        // Wait for the end of even phase
-        odd_barrier.wait_all_nomod();
-#if PRINT
-        cout << "EVEN  ";
-        print_vector(A);
-#endif
-
-        // Reset task manager and barrier
-        tm.set_index(1);
-        odd_barrier.reset();
-
-        // Wait for the end of odd phase
-        even_barrier.wait_all_nomod();
-#if PRINT
-        cout << "ODD   ";
+        cout << "INIT  ";
         print_vector(A);
 #endif
 
-        if(!swapped) break; // Check for termination
-        // Reset task manager and barrier
-        tm.set_index(0);
-        swapped = 0;
-        even_barrier.reset();
-    }
-
-    terminate = true; // Send termination signal
-    even_barrier.reset();
-    for(int i=0; i<nw; i++)
-        workers[i]->join();
+        if(odd_even_par_dyn<T, Compare>(A, nw, chunksize, opt) < 0) return -1;
 
-    auto stop = high_resolution_clock::now();
-    auto total_time = duration_cast<microseconds>(stop - start).count();
+        // Just to make sure it works for larger vectors
+        assert(is_sorted(A.begin(), A.end(), Compare()));
 
+        return 0;
+    };
 
-    cout << "Total time with " << nw << " workers: " << ((float)total_time)/1000.0 << " msecs" << endl;
-    cout << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
-
-    // Just to make sure it works for larger vectors
-    assert(is_sorted(A.begin(), A.end()));
-
-    return 0;
-}
\ No newline at end of file
+    return dispatch_type(type, run);
+}
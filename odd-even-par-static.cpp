@@ -3,12 +3,44 @@
  *
  * Parallel version of the Odd-even Sort using pthread with static
  * division of the work.
- * Uses atomic variables and active barriers for thread synchronization.
+ * Uses atomic variables and active (or hybrid) barriers for thread synchronization,
+ * or a tree barrier that also computes the termination condition. Without a
+ * master thread (-d) main is one of the workers.
+ * The sort itself is odd_even_par_static (Include/StaticEngine.cpp), also
+ * run in-process by odd-even-bench.
  * Takes 3 or 4 arguments:
  *      N     : number of array elements
  *      niter : upper bound for the number of iterations (optional)
  *      seed  : seed for the problem generation
  *      nw    : number of workers
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -i dist : input distribution, generated in parallel and the same for
+ *              any number of threads: random, sorted, reversed, iterK,
+ *              nearlyK, fewK, sawtoothK, organ or zipfS (see Generators.cpp);
+ *              the seed is the one of the generator and niter is ignored
+ *      -b barrier : active (busy waiting), hybrid (spin with pause and
+ *              backoff, then sleep on a futex) or tree (combining tree, the
+ *              workers reduce the swaps at the barrier, without the master)
+ *      -s S  : pauses before sleeping for the hybrid barrier
+ *      -p policy : thread pinning, none, compact (fill a NUMA node first),
+ *              scatter (round robin on the nodes) or a list of CPUs; each
+ *              worker initializes its own block, so that it is allocated
+ *              on its node
+ *      -d    : decentralized termination, main is one of the workers and the
+ *              last worker to arrive at a barrier resets it (implied by -b tree)
+ *      -k K  : temporal blocking, each worker runs K phases on its block
+ *              plus a halo of K elements between two barriers
+ *      -a C  : active region tracking, chunks of C elements that did not
+ *              change (nor their neighbours) in the previous phase are skipped
+ *      -T file : trace the phases and the barriers of each worker, written
+ *              to 'file' at the end in the Chrome trace format
+ *      -H    : hardware counters (cycles, instructions, LLC and branch misses)
+ *              of each worker in the phases and at the barriers
+ *      -K kernel : version of sort_couples, default (widest vectorized one),
+ *              scalar, branchless, simd, run (chosen once by calibration and
+ *              the initial swaps) or phase (chosen by each worker at each
+ *              phase from its previous swaps); prints which kernel ran when
  *
  * Compile with
  * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-par-static.cpp -o odd-even-par-static
@@ -20,29 +52,41 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <chrono>
-#include <atomic>
 #include <cassert>
-#include <mutex>
-#include <thread>
 
-#include "business_logic.cpp"
 #include "utils.cpp"
-#include "ActiveBarrier.cpp"
-#include "Timer.cpp"
+#include "Generators.cpp"
+#include "Affinity.cpp"
+#include "StaticEngine.cpp"
 
 using namespace std;
-using namespace std::chrono;
 
 
 int main(int argc, char const *argv[])
 {
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *input = get_option(argc, argv, "-i", (const char *)nullptr);
+    static_options opt;
+    opt.parse(argc, argv);
+
     if(argc < 4) {
-        cout << "Usage: " << argv[0] << " N [niter] seed nw" << endl;
+        cout << "Usage: " << argv[0] << " N [niter] seed nw [-k K] [-a C] [-t type] [-i dist] [-b barrier] [-s S] [-p policy] [-d] [-T file] [-H] [-K kernel]" << endl;
         cout << "    N     : number of array elements" << endl
              << "    niter : number of iterations (optional)" << endl
              << "    seed  : seed for the random number generator (-1 => reversed vector)" << endl
-             << "    nw    : number of workers" << endl;
+             << "    nw    : number of workers" << endl
+             << "    -k K  : phases run between two barriers (0 => 2 barriers per iteration)" << endl
+             << "    -a C  : skip the chunks of C elements that cannot change (0 => disabled, ignored with -k)" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl
+             << "    -i dist : input distribution (random, sorted, reversed, iterK, nearlyK, fewK, sawtoothK, organ, zipfS)" << endl
+             << "    -b barrier : active (busy waiting), hybrid (spin, then sleep) or tree" << endl
+             << "    -s S  : pauses before sleeping with -b hybrid (<0 => never sleep)" << endl
+             << "    -p policy : pinning, none, compact, scatter or a list of CPUs (e.g. 0,2,4-7)" << endl
+             << "    -d    : no master thread, the workers check the termination" << endl
+             << "    -T file : write a Chrome trace of the phases and barriers to file" << endl
+             << "    -H    : print the hardware counters of the phases and barriers" << endl
+             << "    -K kernel : default, scalar, branchless, simd, run or phase (auto-selection)" << endl;
         return -1;
     }
 
@@ -52,158 +96,34 @@ int main(int argc, char const *argv[])
     int seed  = (argc >= 5) ? atoi(argv[3]) : atoi(argv[2]);
     int nw    = (argc >= 5) ? atoi(argv[4]) : atoi(argv[3]);
 
-    // Statistics
-    unsigned long iter = 0;
-#if STATS
-    mutex print_m; // For mutual exclusive prints
-#endif
-
-    // Vector to be sorted
-    vector<int> A(N);
-    if(seed == -1) fill_reversed(A);
-    else if(niter == 0) fill_random(A, seed);
-    else fill_for_fixed_iterations(A, seed, niter);
-#if PRINT
-    cout << "INIT  ";
-    print_vector(A);
-#endif
-
-
-    auto start = high_resolution_clock::now();
-
-    // Variable for the stopping condition
-    atomic<int> swapped = 0;
-
-    // Variables and structures for synchronization
-    atomic<bool> terminate = false;
-    ActiveBarrier even_barrier(nw), odd_barrier(nw);
-
-    auto worker_fun = [&] (int t)
-    {
-#if STATS
-        unsigned long even_time = 0, even_swaps = 0;  // Statistics for even phase
-        unsigned long odd_time = 0, odd_swaps = 0;    // Statistics for odd phase
-        unsigned long barrier1_t = 0, barrier2_t = 0, update_t = 0; // Overhead statistics
-
-        unsigned long temp;
-#endif
-
-        int E = N/2; // Number of couples in the even phase
-        int start_e = (t == 0) ? 0 : 2*( t*(E/nw) + min(E%nw, t) );
-        int end_e   = (t == nw-1) ? 2*E : start_e + 2*( (E/nw) + (t < E%nw) );
-
-        int O = (N-1)/2; // Number of couples in the odd phae
-        int start_o = 1 + ((t == 0) ? 0 : 2*( t*(O/nw) + min(O%nw, t) ));
-        int end_o   = (t == nw-1) ? 1 + 2*O : start_o + 2*( (O/nw) + (t < O%nw) );
-
-
-        int swapped_prv, nswaps;
-        while(!terminate) {
-            // Even phase
-#if STATS
-            {   Timer t_even(&temp);
-#endif
-                nswaps = sort_couples(A, start_e, end_e);
-                swapped_prv = nswaps;
-#if STATS
-            }   even_time += temp;
-                even_swaps += nswaps;
-#endif
-
-            // Barrier, wait for all the workers to reach it
-#if STATS
-            {   Timer t_b1(&temp);
-#endif
-                odd_barrier.wait_all();
-#if STATS
-            }   barrier1_t += temp;
-#endif
-
-            // Odd phase
-#if STATS
-            {   Timer t_odd(&temp);
-#endif
-                nswaps = sort_couples(A, start_o, end_o);
-                swapped_prv |= nswaps;
-#if STATS
-            }   odd_time += temp;
-                odd_swaps += nswaps;
-#endif
-
-            // Atomicly update the shared variable
-#if STATS
-            {   Timer t_update(&temp);
-#endif
-                swapped |= swapped_prv;
-#if STATS
-            }   update_t += temp;
-#endif
-
-            // Barrier, wait for the master thread (main) to reset the barrier
-#if STATS
-            {   Timer t_b2(&temp);
-#endif
-                even_barrier.wait_reset();
-#if STATS
-            }   barrier2_t += temp;
-#endif
-        } // End of loop
-
-
-#if STATS
-        {
-            unique_lock<mutex> print_lock(print_m);
-            cout << "Worker " << t << ":" << endl
-                 << "\tAvg even phase " << ((float)even_time)/iter/1000 << " usecs"
-                 << " (" << even_swaps/iter << " swaps)" << endl
-                 << "\tAvg barrier 1  " << ((float)barrier1_t)/iter/1000 << " usecs" << endl
-                 << "\tAvg odd phase  " << ((float)odd_time)/iter/1000 << " usecs"
-                 << " (" << odd_swaps/iter << " swaps)" << endl
-                 << "\tAvg update     " << ((float)update_t)/iter/1000 << " usecs" << endl
-                 << "\tAvg barrier 2  " << ((float)barrier2_t)/iter/1000 << " usecs" << endl << endl;
-        }
-#endif
-
-        return;
-    };
-
-    // Start the workers
-    vector<thread*> workers(nw);
-    for(int i=0; i<nw; i++)
-        workers[i] = new thread(worker_fun, i);
-
-    while(true) {
-        iter++;
-
-        // Wait for the end of the iteration
-        even_barrier.wait_all_nomod();
+    // CPU of each worker
+    vector<int> cpus;
+    if(!pin_plan(opt.pinning, nw, cpus)) return -1;
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        // Vector to be sorted, each worker generates its block first
+        vector<T, default_init_allocator<T>> A(N);
+        InputGenerator gen((input) ? input : problem_input(seed, niter).c_str(), N, seed);
+        if(!gen.valid()) return -1;
+        first_touch_fill(A, gen, nw, cpus, [&] (int t, int *lo, int *hi) {
+            even_partition(N, nw, t, lo, hi);
+        });
 #if PRINT
-        cout << "ITER  ";
+        cout << "INIT  ";
         print_vector(A);
 #endif
 
-        // Check for termination
-        if(!swapped) break;
-        odd_barrier.reset();
-        swapped = 0;
-        even_barrier.reset();
-    }
+        if(odd_even_par_static<T, Compare>(A, nw, opt) < 0) return -1;
 
-    terminate = true; // Send termination signal
-    even_barrier.reset();
-    for(int i=0; i<nw; i++)
-        workers[i]->join();
+        // Just to make sure it works for larger vectors
+        assert(is_sorted(A.begin(), A.end(), Compare()));
 
-    auto stop = high_resolution_clock::now();
-    auto total_time = duration_cast<microseconds>(stop - start).count();
-
-
-    cout << "Total time with " << nw << " workers: " << ((float)total_time)/1000.0 << " msecs" << endl;
-    cout << "Iterations: " << iter << " (" << ((float)total_time)/iter << " usecs per iteration)" << endl;
-
-
-    // Just to make sure it works for larger vectors
-    assert(is_sorted(A.begin(), A.end()));
+        return 0;
+    };
 
-    return 0;
-}
\ No newline at end of file
+    return dispatch_type(type, run);
+}
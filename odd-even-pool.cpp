@@ -0,0 +1,121 @@
+/*
+ * ---- odd-even-pool.cpp
+ *
+ * Latency benchmark for many back-to-back sorts of medium-sized arrays,
+ * with the library interface (odd_even_sort.cpp): the same sorts are run
+ * creating the threads at each call and on a persistent WorkerPool.
+ * Takes 4 arguments:
+ *      N      : number of array elements
+ *      nsorts : number of sorts
+ *      seed   : seed for the problem generation
+ *      nw     : number of workers
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -m mode : static (default), dyn or block
+ *      -c C    : chunksize for -m dyn (0 => adaptive)
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-pool.cpp -o odd-even-pool
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+#include <cstring>
+
+#include "utils.cpp"
+#include "odd_even_sort.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *mode = get_option(argc, argv, "-m", "static");
+    int chunksize = get_option(argc, argv, "-c", 0);
+
+    if(argc < 5) {
+        cout << "Usage: " << argv[0] << " N nsorts seed nw [-m mode] [-c C] [-t type]" << endl;
+        cout << "    N      : number of array elements" << endl
+             << "    nsorts : number of back-to-back sorts" << endl
+             << "    seed   : seed for the problem generation (-1 => reversed vector)" << endl
+             << "    nw     : number of workers" << endl
+             << "    -m mode : static, dyn or block" << endl
+             << "    -c C    : chunksize with -m dyn (0 => adaptive)" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl;
+        return -1;
+    }
+
+    // Command line arguments
+    int N      = atoi(argv[1]);
+    int nsorts = max(1, atoi(argv[2]));
+    int seed   = atoi(argv[3]);
+    int nw     = atoi(argv[4]);
+
+    // Calls 'f' with the policy named 'mode'
+    auto dispatch_policy = [&] (auto f) {
+        if(strcmp(mode, "static") == 0) return f(static_policy{nw});
+        if(strcmp(mode, "dyn") == 0)    return f(dynamic_policy{nw, chunksize});
+        if(strcmp(mode, "block") == 0)  return f(block_policy{nw});
+
+        cout << "Unknown mode " << mode << endl;
+        return -1;
+    };
+
+    // The whole computation is templated on the element type and on the policy
+    auto run = [&] (auto tag, auto policy) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        vector<T> P(N), A(N);
+        fill_problem(P, seed, 0);
+
+        /*
+         * Runs the sorts with 'sort_fn(A)', prints the latency statistics
+         * (the copy of the problem is not measured)
+         */
+        auto bench = [&] (const char *name, auto sort_fn) {
+            vector<double> lat(nsorts);
+            for(int i=0; i<nsorts; i++) {
+                copy(P.begin(), P.end(), A.begin());
+
+                auto start = high_resolution_clock::now();
+                sort_fn(A);
+                auto stop = high_resolution_clock::now();
+
+                lat[i] = duration_cast<nanoseconds>(stop - start).count()/1000.0;
+                assert(is_sorted(A.begin(), A.end(), Compare()));
+            }
+
+            double total = 0;
+            for(double l : lat) total += l;
+            sort(lat.begin(), lat.end());
+
+            cout << name << ": " << nsorts << " sorts, " << nsorts/(total/1e6) << " sorts/s" << endl
+                 << "\tAvg latency    " << total/nsorts << " usecs" << endl
+                 << "\tMin latency    " << lat[0] << " usecs" << endl
+                 << "\tMedian latency " << lat[nsorts/2] << " usecs" << endl
+                 << "\tp99 latency    " << lat[min(nsorts-1, nsorts*99/100)] << " usecs" << endl;
+        };
+
+        bench("New threads", [&] (vector<T> &v) {
+            odd_even_sort(v.begin(), v.end(), policy, Compare());
+        });
+
+        WorkerPool pool(nw);
+        bench("Worker pool", [&] (vector<T> &v) {
+            odd_even_sort(pool, v.begin(), v.end(), policy, Compare());
+        });
+
+        return 0;
+    };
+
+    return dispatch_type(type, [&] (auto tag) {
+        return dispatch_policy([&] (auto policy) { return run(tag, policy); });
+    });
+}
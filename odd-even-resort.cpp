@@ -0,0 +1,109 @@
+/*
+ * ---- odd-even-resort.cpp
+ *
+ * Benchmark for the incremental re-sort of the library interface
+ * (odd_even_resort): a sorted array gets a few elements changed, then it is
+ * re-sorted comparing only the couples in the windows around the displaced
+ * elements, and from scratch with the static version, on the same
+ * WorkerPool. Prints the phases and the couples compared by both.
+ * Takes 4 arguments:
+ *      N    : number of array elements
+ *      k    : number of changed elements
+ *      seed : seed for the choice of the changes
+ *      nw   : number of workers
+ * and the options:
+ *      -d D    : the new values are within D positions of the old ones
+ *                (0 => anywhere, default)
+ *      -g G    : couples of a phase per worker of the re-sort (default 4096)
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-resort.cpp -o odd-even-resort
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+
+#include "utils.cpp"
+#include "Generators.cpp"
+#include "odd_even_sort.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    long D = get_option(argc, argv, "-d", 0);
+    int grain = get_option(argc, argv, "-g", 1 << 12);
+
+    if(argc < 5) {
+        cout << "Usage: " << argv[0] << " N k seed nw [-d D] [-g G] [-t type]" << endl;
+        cout << "    N    : number of array elements" << endl
+             << "    k    : number of changed elements" << endl
+             << "    seed : seed for the choice of the changes" << endl
+             << "    nw   : number of workers" << endl
+             << "    -d D    : new values within D positions of the old ones (0 => anywhere)" << endl
+             << "    -g G    : couples of a phase per worker of the re-sort" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl;
+        return -1;
+    }
+
+    // Command line arguments
+    long N   = max(2, atoi(argv[1]));
+    long k   = max(0, atoi(argv[2]));
+    int seed = atoi(argv[3]);
+    int nw   = max(1, atoi(argv[4]));
+
+    // The whole computation is templated on the element type
+    auto run = [&] (auto tag) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        // Sorted array of the even numbers, the new values are odd
+        vector<T> P(N), A(N);
+        for(long i=0; i<N; i++) P[i] = T(2*i);
+
+        vector<size_t> modified(k);
+        for(long m=0; m<k; m++) {
+            long i = counter_rng(seed, 2*m) % N;
+            unsigned long r = counter_rng(seed, 2*m+1);
+            long pos = (D > 0) ? min(N-1, max(0L, i - D + (long)(r % (2*D+1)))) : (long)(r % N);
+            modified[m] = i;
+            P[i] = T(2*pos + 1);
+        }
+
+        WorkerPool pool(nw);
+
+        copy(P.begin(), P.end(), A.begin());
+        auto start = high_resolution_clock::now();
+        resort_stats st = odd_even_resort(pool, A.data(), N, modified, static_policy{nw}, Compare(), grain);
+        auto stop = high_resolution_clock::now();
+        auto resort_time = duration_cast<microseconds>(stop - start).count();
+        assert(is_sorted(A.begin(), A.end(), Compare()));
+
+        copy(P.begin(), P.end(), A.begin());
+        start = high_resolution_clock::now();
+        unsigned long iter = odd_even_sort(pool, A.data(), N, static_policy{nw}, Compare());
+        stop = high_resolution_clock::now();
+        auto scratch_time = duration_cast<microseconds>(stop - start).count();
+        assert(is_sorted(A.begin(), A.end(), Compare()));
+
+        cout << N << " elements, " << k << " changed, " << nw << " workers" << endl;
+        cout << "Incremental : " << ((float)resort_time)/1000.0 << " msecs, "
+             << st.phases << " phases, " << st.couples << " couples compared, "
+             << st.swaps << " swaps" << endl
+             << "\tAt most " << st.max_windows << " windows, " << st.max_active << " elements, "
+             << st.full_phases << " phases on the whole array" << endl;
+        cout << "From scratch: " << ((float)scratch_time)/1000.0 << " msecs, "
+             << 2*iter << " phases, " << iter*(N-1) << " couples compared" << endl;
+        return 0;
+    };
+
+    return dispatch_type(type, run);
+}
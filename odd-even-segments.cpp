@@ -0,0 +1,132 @@
+/*
+ * ---- odd-even-segments.cpp
+ *
+ * Throughput benchmark for the segmented mode of the library interface
+ * (odd_even_sort_segments): many independent arrays, stored in a flat
+ * buffer with their offsets, are sorted at once. The small segments are
+ * sorted each by a single worker, the large ones by all the workers.
+ * The result is compared with sorting the segments one at a time with the
+ * parallel version, on the same WorkerPool.
+ * Takes 5 arguments:
+ *      nseg  : number of segments
+ *      min   : minimum length of a segment
+ *      max   : maximum length of a segment
+ *      seed  : seed for the problem generation
+ *      nw    : number of workers
+ * and the options:
+ *      -t type : element type (int, int64, float, double, record, record64)
+ *      -m mode : policy for the large segments, static (default), dyn or block
+ *      -l L    : segments of at least L elements are large (default 16384)
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-segments.cpp -o odd-even-segments
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cassert>
+#include <cstring>
+
+#include "utils.cpp"
+#include "odd_even_sort.cpp"
+
+using namespace std;
+using namespace std::chrono;
+
+
+int main(int argc, char const *argv[])
+{
+    // Options
+    const char *type = get_option(argc, argv, "-t", "int");
+    const char *mode = get_option(argc, argv, "-m", "static");
+    int L = get_option(argc, argv, "-l", 1 << 14);
+
+    if(argc < 6) {
+        cout << "Usage: " << argv[0] << " nseg min max seed nw [-m mode] [-l L] [-t type]" << endl;
+        cout << "    nseg  : number of segments" << endl
+             << "    min   : minimum length of a segment" << endl
+             << "    max   : maximum length of a segment" << endl
+             << "    seed  : seed for the problem generation" << endl
+             << "    nw    : number of workers" << endl
+             << "    -m mode : policy for the large segments, static, dyn or block" << endl
+             << "    -l L    : segments of at least L elements are large" << endl
+             << "    -t type : element type (int, int64, float, double, record, record64)" << endl;
+        return -1;
+    }
+
+    // Command line arguments
+    int nseg   = max(1, atoi(argv[1]));
+    int minlen = atoi(argv[2]);
+    int maxlen = max(minlen, atoi(argv[3]));
+    int seed   = atoi(argv[4]);
+    int nw     = atoi(argv[5]);
+
+    // Segments of random length
+    vector<size_t> offsets(nseg+1, 0);
+    default_random_engine gen(seed);
+    uniform_int_distribution<int> len(minlen, maxlen);
+    for(int i=0; i<nseg; i++)
+        offsets[i+1] = offsets[i] + len(gen);
+    size_t total = offsets[nseg];
+
+    // Calls 'f' with the policy named 'mode'
+    auto dispatch_policy = [&] (auto f) {
+        if(strcmp(mode, "static") == 0) return f(static_policy{nw});
+        if(strcmp(mode, "dyn") == 0)    return f(dynamic_policy{nw, 0});
+        if(strcmp(mode, "block") == 0)  return f(block_policy{nw});
+
+        cout << "Unknown mode " << mode << endl;
+        return -1;
+    };
+
+    // The whole computation is templated on the element type and on the policy
+    auto run = [&] (auto tag, auto policy) {
+        using T = typename decltype(tag)::type;
+        using Compare = typename decltype(tag)::compare;
+
+        vector<T> P(total), A(total);
+        fill_problem(P, seed, 0);
+
+        WorkerPool pool(nw);
+
+        /*
+         * Runs 'sort_fn()' on a fresh copy of the problem and prints the
+         * throughput (the copy is not measured)
+         */
+        auto bench = [&] (const char *name, auto sort_fn) {
+            copy(P.begin(), P.end(), A.begin());
+
+            auto start = high_resolution_clock::now();
+            sort_fn();
+            auto stop = high_resolution_clock::now();
+            auto total_time = duration_cast<microseconds>(stop - start).count();
+
+            for(int i=0; i<nseg; i++)
+                assert(is_sorted(A.begin()+offsets[i], A.begin()+offsets[i+1], Compare()));
+
+            cout << name << ": " << ((float)total_time)/1000.0 << " msecs, "
+                 << nseg/(total_time/1e6) << " segments/s, "
+                 << total/(total_time/1e6) << " elements/s" << endl;
+        };
+
+        cout << nseg << " segments, " << total << " elements, " << nw << " workers" << endl;
+
+        bench("Batched  ", [&] () {
+            odd_even_sort_segments(pool, A.data(), offsets, policy, L, Compare());
+        });
+
+        bench("Parallel ", [&] () {
+            for(int i=0; i<nseg; i++)
+                odd_even_sort(pool, A.data()+offsets[i], offsets[i+1]-offsets[i], policy, Compare());
+        });
+
+        return 0;
+    };
+
+    return dispatch_type(type, [&] (auto tag) {
+        return dispatch_policy([&] (auto policy) { return run(tag, policy); });
+    });
+}
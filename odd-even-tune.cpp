@@ -0,0 +1,196 @@
+/*
+ * ---- odd-even-tune.cpp
+ *
+ * Auto-tuner for the number of workers and the chunksize of the dynamic
+ * version: for each element type and size it runs short calibration sorts
+ * (problems sortable in a few iterations) with the engine of
+ * odd-even-par-dyn (odd_even_par_dyn, with its placement), first over the
+ * numbers of workers with adaptive chunks, then over the chunksizes with the
+ * best number of workers. The fixed chunksize of odd-even-ff is calibrated
+ * with its engine (odd_even_ff) when FastFlow is available, otherwise it is
+ * the best fixed chunksize of the dynamic version. The results are written
+ * to the machine profile (see Profile.cpp), read by odd-even-par-dyn and
+ * odd-even-ff when nw or chunksize is given as "auto".
+ * Takes no arguments, the options are comma-separated lists:
+ *      -t types : element types (default int)
+ *      -n N     : sizes, each one tunes the range up to the next one
+ *                 (default 16384,262144,1048576)
+ *      -w nw    : candidate numbers of workers, ranges allowed
+ *                 (default powers of 2 up to the available cores)
+ *      -c C     : candidate chunksizes (default 0,256,1024,4096,16384)
+ * and the options:
+ *      -i iter  : iterations of a calibration sort (default 32)
+ *      -r R     : runs per setting, the median is kept (default 3)
+ *      -o file  : profile to be written (default the one of this host)
+ *
+ * Compile with
+ * g++ -g -O3 -std=c++17 -ftree-vectorize -pthread odd-even-tune.cpp -o odd-even-tune
+ * (the FastFlow version is calibrated when its headers are in the include path)
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cassert>
+
+#include "utils.cpp"
+#include "Affinity.cpp"
+#include "Profile.cpp"
+#include "DynEngine.cpp"
+
+#if __has_include(<ff/parallel_for.hpp>)
+#define HAVE_FF 1
+#include "FFEngine.cpp"
+#else
+#define HAVE_FF 0
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+
+int main(int argc, char const *argv[])
+{
+    // Default candidates for the workers, powers of 2 and the available cores
+    int cores = max(1u, thread::hardware_concurrency());
+    string def_nw;
+    for(int w=1; w<cores; w*=2) def_nw += to_string(w) + ",";
+    def_nw += to_string(cores);
+
+    // Options
+    string types = get_option(argc, argv, "-t", "int");
+    vector<int> sizes = parse_cpulist(get_option(argc, argv, "-n", "16384,262144,1048576"));
+    vector<int> nws = parse_cpulist(get_option(argc, argv, "-w", def_nw.c_str()));
+    vector<int> chunks = parse_cpulist(get_option(argc, argv, "-c", "0,256,1024,4096,16384"));
+    int calib_iter = max(1, get_option(argc, argv, "-i", 32));
+    int R = max(1, get_option(argc, argv, "-r", 3));
+    string path = get_option(argc, argv, "-o", profile_path().c_str());
+
+    if(argc > 1 || sizes.empty() || nws.empty() || chunks.empty()) {
+        cout << "Usage: " << argv[0] << " [-t types] [-n N] [-w nw] [-c C] [-i iter] [-r R] [-o file]" << endl;
+        cout << "    -t types : element types (int, int64, float, double, record, record64)" << endl
+             << "    -n N     : sizes, each one tunes the range up to the next one" << endl
+             << "    -w nw    : candidate numbers of workers (e.g. 1-16)" << endl
+             << "    -c C     : candidate chunksizes (0 => adaptive)" << endl
+             << "    -i iter  : iterations of a calibration sort" << endl
+             << "    -r R     : runs per setting" << endl
+             << "    -o file  : profile to be written" << endl;
+        return -1;
+    }
+    sort(sizes.begin(), sizes.end());
+
+    // The entries of the other types are kept
+    vector<ProfileEntry> profile;
+    vector<string> tuned;
+    for(size_t pos = 0; pos < types.size(); ) {
+        size_t end = types.find(',', pos);
+        if(end == string::npos) end = types.size();
+        if(end > pos) tuned.push_back(types.substr(pos, end-pos));
+        pos = end+1;
+    }
+    for(auto &e : read_profile(path))
+        if(find(tuned.begin(), tuned.end(), e.type) == tuned.end()) profile.push_back(e);
+
+    for(auto &type : tuned) {
+        // The whole computation is templated on the element type
+        int ret = dispatch_type(type.c_str(), [&] (auto tag) {
+            using T = typename decltype(tag)::type;
+            using Compare = typename decltype(tag)::compare;
+
+            for(size_t s=0; s<sizes.size(); s++) {
+                int N = max(sizes[s], 2);
+                vector<T> P(N), A(N);
+                fill_problem(P, 42, calib_iter);
+
+                // Median time of the calibration sorts of an engine, in usecs
+                auto calibrate = [&] (const char *engine, int nw, int chunksize, auto &v, auto refill, auto sort_fn) {
+                    vector<double> times;
+                    for(int r=0; r<R; r++) {
+                        refill(v);
+                        auto start = high_resolution_clock::now();
+                        sort_fn(v);
+                        auto stop = high_resolution_clock::now();
+                        assert(is_sorted(v.begin(), v.end(), Compare()));
+                        times.push_back(duration_cast<nanoseconds>(stop - start).count()/1000.0);
+                    }
+                    sort(times.begin(), times.end());
+                    cout << type << " " << engine << " N=" << N << " nw=" << nw << " chunksize=" << chunksize
+                         << ": " << times[R/2] << " usecs" << endl;
+                    return times[R/2];
+                };
+
+                // The dynamic version, placed by its workers as in odd-even-par-dyn
+                dyn_options dyn_opt;
+                dyn_opt.report = false;
+                auto measure = [&] (int nw, int chunksize) {
+                    DynPlacement place;
+                    place.plan(dyn_opt.pinning, N, nw);
+                    vector<T, default_init_allocator<T>> B(N);
+                    return calibrate("dyn", nw, chunksize, B, [&] (auto &v) {
+                        first_touch_fill(v, [&] (int i) { return P[i]; }, nw, place.cpus, [&] (int t, int *lo, int *hi) {
+                            place.part(t, lo, hi);
+                        });
+                    }, [&] (auto &v) {
+                        odd_even_par_dyn<T, Compare>(v, nw, chunksize, dyn_opt);
+                    });
+                };
+
+                // Workers, with adaptive chunks
+                int best_nw = 1;
+                double best_t = 1e300;
+                for(int nw : nws) {
+                    if(nw < 1 || nw > N/2) continue;
+                    double t = measure(nw, 0);
+                    if(t < best_t) { best_t = t; best_nw = nw; }
+                }
+
+                // Chunksizes, with the best number of workers
+                int best_chunk = 0, best_fixed = 0;
+                double best_fixed_t = 1e300;
+                for(int c : chunks) {
+                    if(c == 0 || c > N/best_nw) continue;
+                    c = max(2, c + c%2);
+                    double t = measure(best_nw, c);
+                    if(t < best_t) { best_t = t; best_chunk = c; }
+                    if(t < best_fixed_t) { best_fixed_t = t; best_fixed = c; }
+                }
+#if HAVE_FF
+                // Fixed chunksizes of the FastFlow version, with the same workers
+                ff_options ff_opt;
+                ff_opt.report = false;
+                best_fixed = 0;
+                best_fixed_t = 1e300;
+                for(int c : chunks) {
+                    if(c == 0 || c > N/best_nw) continue;
+                    c = max(2, c + c%2);
+                    double t = calibrate("ff", best_nw, c, A, [&] (vector<T> &v) {
+                        copy(P.begin(), P.end(), v.begin());
+                    }, [&] (vector<T> &v) {
+                        odd_even_ff<T, Compare>(v, best_nw, c, ff_opt);
+                    });
+                    if(t < best_fixed_t) { best_fixed_t = t; best_fixed = c; }
+                }
+#endif
+                if(best_fixed == 0) best_fixed = max(2, (N/best_nw + 1) & ~1);
+
+                long lo = (s == 0) ? 0 : sizes[s];
+                long hi = (s+1 < sizes.size()) ? sizes[s+1] : LONG_MAX;
+                profile.push_back({type, lo, hi, best_nw, best_chunk, best_fixed});
+                cout << "=> " << type << " " << lo << "-" << hi << ": " << best_nw
+                     << " workers, chunksize " << best_chunk << " (fixed " << best_fixed << ")" << endl;
+            }
+            return 0;
+        });
+        if(ret != 0) return ret;
+    }
+
+    if(!write_profile(path, profile)) {
+        cout << "Cannot write " << path << endl;
+        return -1;
+    }
+    cout << "Profile written to " << path << endl;
+    return 0;
+}
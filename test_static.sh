@@ -1,22 +0,0 @@
-if [[ $# < 4 ]]; then
-	echo USE: $0 nruns output-file N niter
-	exit 0
-fi
-
-RUNS=$1
-OUT_FILE=$2
-N=$3
-NITER=$4
-
-make clean
-make odd-even-par-static
-
-rm $OUT_FILE 2>/dev/null
-touch $OUT_FILE
-
-for (( nw = 1; nw < 11; nw++ )); do
-	for (( i = 0; i < RUNS; i++ )); do
-		./odd-even-par-static $N $NITER 42 $nw >> $OUT_FILE
-		sleep 1
-	done
-done
\ No newline at end of file